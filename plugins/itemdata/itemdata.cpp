@@ -48,51 +48,115 @@ QString escapeHtml(const QString &str)
 #endif
 }
 
-QString hexData(const QByteArray &data)
+const char hexDigits[] = "0123456789abcdef";
+
+/** Append HTML-escaped printable ASCII character or dot to @a out. */
+inline char *appendEscapedChar(char *out, uchar c)
+{
+    const char *escaped = NULL;
+    switch (c) {
+    case '<': escaped = "&lt;"; break;
+    case '>': escaped = "&gt;"; break;
+    case '&': escaped = "&amp;"; break;
+    case '"': escaped = "&quot;"; break;
+    default:
+        *out++ = (c >= 0x20 && c < 0x7f) ? static_cast<char>(c) : '.';
+        return out;
+    }
+
+    while (*escaped != '\0')
+        *out++ = *escaped++;
+    return out;
+}
+
+/**
+ * Return hex dump (escaped for HTML) of @a length bytes from @a data starting at @a offset.
+ *
+ * Each line contains offset, 16 bytes in hexadecimal and printable characters.
+ * Output is written into preallocated buffer using lookup table.
+ */
+QString hexData(const QByteArray &data, int offset, int length)
 {
-    if ( data.isEmpty() )
+    const int end = qMin( data.size(), offset + length );
+    if (offset < 0 || offset >= end)
         return QString();
 
-    QString result;
-    QString chars;
-
-    int i = 0;
-    forever {
-        if (i > 0) {
-            if ( (i % 2) == 0 )
-                result.append( QString(" ") );
-            if ( (i % 16) == 0 ) {
-                result.append(" ");
-                result.append(chars);
-                result.append( QString("\n") );
-                chars.clear();
-                if (i >= data.size() )
-                    break;
+    // Number of hex digits for line offset.
+    int offsetDigits = 4;
+    while ( offsetDigits < 8 && ((end - 1) >> (4 * offsetDigits)) != 0 )
+        ++offsetDigits;
+
+    // offset, ": ", 8 groups "xxxx ", " ", 16 escaped characters (at most "&quot;"), "\n"
+    const int maxLineLength = offsetDigits + 2 + 8 * 5 + 1 + 16 * 6 + 1;
+    const int lineCount = (end - offset + 15) / 16;
+
+    QByteArray result(lineCount * maxLineLength, Qt::Uninitialized);
+    char *out = result.data();
+    const uchar *bytes = reinterpret_cast<const uchar *>( data.constData() );
+
+    for ( int line = offset; line < end; line += 16 ) {
+        for ( int shift = 4 * (offsetDigits - 1); shift >= 0; shift -= 4 )
+            *out++ = hexDigits[(line >> shift) & 0xf];
+        *out++ = ':';
+        *out++ = ' ';
+
+        const int lineEnd = qMin(end, line + 16);
+        for ( int i = line; i < line + 16; ++i ) {
+            if (i < lineEnd) {
+                *out++ = hexDigits[bytes[i] >> 4];
+                *out++ = hexDigits[bytes[i] & 0xf];
+            } else {
+                *out++ = ' ';
+                *out++ = ' ';
             }
-        }
-        if ( (i % 16) == 0 ) {
-            result.append( QString("%1: ").arg(QString::number(i, 16), 4, QChar('0')) );
-        }
-        if (i < data.size() ) {
-            QChar c = data[i];
-            result.append( QString("%1").arg(QString::number(c.unicode(), 16), 2, QChar('0')) );
-            chars.append( c.isPrint() ? escapeHtml(QString(c)) : QString(".") );
-        } else {
-            result.append( QString("  ") );
+            if ( ((i - line) % 2) == 1 )
+                *out++ = ' ';
         }
 
-        ++i;
+        *out++ = ' ';
+        for ( int i = line; i < lineEnd; ++i )
+            out = appendEscapedChar(out, bytes[i]);
+        *out++ = '\n';
     }
 
-    return result;
+    result.resize( static_cast<int>(out - result.constData()) );
+
+    return QString::fromLatin1( result.constData(), result.size() );
 }
 
-QString stringFromBytes(const QByteArray &bytes, const QString &format)
+QTextCodec *codecForData(const QByteArray &bytes, const QString &format)
 {
     QTextCodec *codec = QTextCodec::codecForName("utf-8");
     if (format == QLatin1String("text/html"))
         codec = QTextCodec::codecForHtml(bytes, codec);
-    return codec->toUnicode(bytes);
+    return codec;
+}
+
+/** Move @a position back to start of UTF-8 character (at most 3 bytes). */
+int utf8CharacterStart(const QByteArray &data, int position)
+{
+    for (int i = 0; i < 3 && position > 0 && position < data.size()
+         && (data[position] & 0xc0) == 0x80; ++i)
+    {
+        --position;
+    }
+    return position;
+}
+
+/** Decode text page starting at @a offset without splitting UTF-8 characters. */
+QString textPage(const QByteArray &bytes, const QString &format, int offset, int pageSize)
+{
+    QTextCodec *codec = codecForData(bytes, format);
+
+    int begin = offset;
+    int end = qMin(bytes.size(), offset + pageSize);
+    // Page boundaries are same for both neighbor pages.
+    if (codec->mibEnum() == 106) {
+        begin = utf8CharacterStart(bytes, begin);
+        end = utf8CharacterStart(bytes, end);
+    }
+
+    return codec->toUnicode(bytes.constData() + begin, end - begin);
 }
 
 bool emptyIntersection(const QStringList &lhs, const QStringList &rhs)
@@ -107,28 +171,58 @@ bool emptyIntersection(const QStringList &lhs, const QStringList &rhs)
 
 } // namespace
 
-ItemData::ItemData(const QModelIndex &index, int maxBytes, QWidget *parent)
+ItemData::ItemData(const QModelIndex &index, const QStringList &formats, int maxBytes,
+                   QWidget *parent)
     : QLabel(parent)
     , ItemWidget(this)
+    , m_formats(formats)
+    , m_data()
+    , m_pages()
+    , m_pageSize( qMax(16, maxBytes) )
 {
-    setTextInteractionFlags(Qt::TextSelectableByMouse);
+    setTextInteractionFlags(Qt::TextSelectableByMouse | Qt::LinksAccessibleByMouse);
     setContentsMargins(4, 4, 4, 4);
     setTextFormat(Qt::RichText);
 
+    for (int i = 0; i < m_formats.size(); ++i ) {
+        m_data.append( index.data(contentType::firstFormat + i).toByteArray() );
+        m_pages.append(0);
+    }
+
+    connect( this, SIGNAL(linkActivated(QString)),
+             this, SLOT(onLinkActivated(QString)) );
+
+    updateText();
+}
+
+void ItemData::onLinkActivated(const QString &link)
+{
+    // Link format is "FORMAT_INDEX:PAGE".
+    const int i = link.section(':', 0, 0).toInt();
+    if ( i < 0 || i >= m_pages.size() )
+        return;
+
+    const int pageCount = (m_data[i].size() + m_pageSize - 1) / m_pageSize;
+    m_pages[i] = qBound( 0, link.section(':', 1, 1).toInt(), pageCount - 1 );
+
+    updateText();
+}
+
+void ItemData::updateText()
+{
     QString text;
 
-    const QStringList formats = index.data(contentType::formats).toStringList();
-    for (int i = 0; i < formats.size(); ++i ) {
-        QByteArray data = index.data(contentType::firstFormat + i).toByteArray();
+    for (int i = 0; i < m_formats.size(); ++i ) {
+        const QByteArray &data = m_data[i];
         const int size = data.size();
-        bool trimmed = size > maxBytes;
-        if (trimmed)
-            data = data.left(maxBytes);
+        const int offset = m_pages[i] * m_pageSize;
 
-        const QString &format = formats[i];
+        const QString &format = m_formats[i];
         bool hasText = format.startsWith("text/") ||
                        format.startsWith("application/x-copyq-owner-window-title");
-        const QString content = hasText ? escapeHtml(stringFromBytes(data, format)) : hexData(data);
+        const QString content = hasText
+                ? escapeHtml( textPage(data, format, offset, m_pageSize) )
+                : hexData(data, offset, m_pageSize);
         text.append( QString("<p>") );
         text.append( QString("<b>%1</b> (%2 bytes)<pre>%3</pre>")
                      .arg(format)
@@ -136,8 +230,22 @@ ItemData::ItemData(const QModelIndex &index, int maxBytes, QWidget *parent)
                      .arg(content) );
         text.append( QString("</p>") );
 
-        if (trimmed)
-            text.append( QString("<p>...</p>") );
+        // Links to show previous and next page.
+        if (size > m_pageSize) {
+            const int page = m_pages[i];
+            const int pageCount = (size + m_pageSize - 1) / m_pageSize;
+            text.append( QString("<p>") );
+            if (page > 0) {
+                text.append( QString("<a href=\"%1:0\">|&lt;</a> ").arg(i) );
+                text.append( QString("<a href=\"%1:%2\">&lt;</a> ").arg(i).arg(page - 1) );
+            }
+            text.append( tr("page %1 of %2").arg(page + 1).arg(pageCount) );
+            if (page + 1 < pageCount) {
+                text.append( QString(" <a href=\"%1:%2\">&gt;</a>").arg(i).arg(page + 1) );
+                text.append( QString(" <a href=\"%1:%2\">&gt;|</a>").arg(i).arg(pageCount - 1) );
+            }
+            text.append( QString("</p>") );
+        }
     }
 
     setText(text);
@@ -182,13 +290,14 @@ ItemDataLoader::~ItemDataLoader()
     delete ui;
 }
 
-ItemWidget *ItemDataLoader::create(const QModelIndex &index, QWidget *parent) const
+ItemWidget *ItemDataLoader::create(const QModelIndex &index, const QStringList &formats,
+                                   QWidget *parent) const
 {
-    const QStringList formats = index.data(contentType::formats).toStringList();
     if ( emptyIntersection(formats, formatsToSave()) )
         return NULL;
 
-    return new ItemData( index, m_settings.value("max_bytes", defaultMaxBytes).toInt(), parent );
+    return new ItemData( index, formats, m_settings.value("max_bytes", defaultMaxBytes).toInt(),
+                         parent );
 }
 
 QStringList ItemDataLoader::formatsToSave() const
@@ -35,7 +35,8 @@ class ItemData : public QLabel, public ItemWidget
     Q_OBJECT
 
 public:
-    ItemData(const QModelIndex &index, int maxBytes, QWidget *parent);
+    ItemData(const QModelIndex &index, const QStringList &formats, int maxBytes,
+             QWidget *parent);
 
 protected:
     virtual void highlight(const QRegExp &re, const QFont &highlightFont,
@@ -48,6 +49,18 @@ protected:
     virtual void mouseDoubleClickEvent(QMouseEvent *e);
 
     virtual void contextMenuEvent(QContextMenuEvent *e);
+
+private slots:
+    void onLinkActivated(const QString &link);
+
+private:
+    /** Show current page of data for each format. */
+    void updateText();
+
+    QStringList m_formats;
+    QList<QByteArray> m_data;
+    QList<int> m_pages;
+    int m_pageSize;
 };
 
 class ItemDataLoader : public QObject, public ItemLoaderInterface
@@ -61,7 +74,8 @@ public:
 
     ~ItemDataLoader();
 
-    virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
+    virtual ItemWidget *create(const QModelIndex &index, const QStringList &formats,
+                               QWidget *parent) const;
 
     virtual QString id() const { return "itemdata"; }
     virtual QString name() const { return tr("&Data Items"); }
@@ -70,6 +84,8 @@ public:
 
     virtual QStringList formatsToSave() const;
 
+    virtual QStringList formatsToRender() const { return formatsToSave(); }
+
     virtual QVariantMap applySettings();
 
     virtual void loadSettings(const QVariantMap &settings) { m_settings = settings; }
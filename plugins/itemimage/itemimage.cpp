@@ -26,6 +26,7 @@
 #include <QHBoxLayout>
 #include <QModelIndex>
 #include <QPixmap>
+#include <QThreadPool>
 #include <QtPlugin>
 #include <QVariant>
 
@@ -46,10 +47,9 @@ int findImageFormat(const QStringList &formats)
     return -1;
 }
 
-bool getImageData(const QModelIndex &index, QByteArray *data, QString *mime)
+bool getImageData(const QModelIndex &index, const QStringList &formats,
+                  QByteArray *data, QString *mime)
 {
-    const QStringList formats = index.data(contentType::formats).toStringList();
-
     int i = findImageFormat(formats);
     if (i == -1)
         return false;
@@ -60,29 +60,21 @@ bool getImageData(const QModelIndex &index, QByteArray *data, QString *mime)
     return true;
 }
 
-bool getPixmapFromData(const QModelIndex &index, QPixmap *pix)
-{
-    QString mime;
-    QByteArray data;
-    if ( !getImageData(index, &data, &mime) )
-        return false;
-
-    pix->loadFromData( data, mime.toLatin1() );
-
-    return true;
-}
-
 } // namespace
 
-ItemImage::ItemImage(const QPixmap &pix, const QString &imageEditor, const QString &svgEditor,
-                     QWidget *parent)
+ItemImage::ItemImage(const QString &imageEditor, const QString &svgEditor, QWidget *parent)
     : QLabel(parent)
     , ItemWidget(this)
     , m_editor(imageEditor)
     , m_svgEditor(svgEditor)
 {
     setMargin(4);
-    setPixmap(pix);
+    resize( 0, fontMetrics().lineSpacing() );
+}
+
+void ItemImage::setImage(const QImage &image)
+{
+    setPixmap( QPixmap::fromImage(image) );
     updateSize();
 }
 
@@ -90,7 +82,8 @@ QObject *ItemImage::createExternalEditor(const QModelIndex &index, QWidget *pare
 {
     QString mime;
     QByteArray data;
-    if ( !getImageData(index, &data, &mime) )
+    const QStringList formats = index.data(contentType::formats).toStringList();
+    if ( !getImageData(index, formats, &data, &mime) )
         return NULL;
 
     const QString &cmd = mime.contains("svg") ? m_svgEditor : m_editor;
@@ -103,6 +96,38 @@ void ItemImage::updateSize()
     adjustSize();
 }
 
+ItemImagePreviewJob::ItemImagePreviewJob(
+        const QByteArray &data, const QString &mime, int maxWidth, int maxHeight)
+    : QObject()
+    , QRunnable()
+    , m_data(data)
+    , m_mime(mime)
+    , m_maxWidth(maxWidth)
+    , m_maxHeight(maxHeight)
+{
+    // Job object lives in GUI thread so it must not be deleted in worker thread.
+    setAutoDelete(false);
+    connect( this, SIGNAL(finished(QImage)), this, SLOT(deleteLater()) );
+}
+
+void ItemImagePreviewJob::run()
+{
+    QImage image;
+    image.loadFromData( m_data, m_mime.toLatin1() );
+    m_data.clear();
+
+    // scale image
+    const int w = m_maxWidth;
+    const int h = m_maxHeight;
+    if ( w > 0 && image.width() > w && (h <= 0 || image.width()/w > image.height()/h) ) {
+        image = image.scaledToWidth(w);
+    } else if (h > 0 && image.height() > h) {
+        image = image.scaledToHeight(h);
+    }
+
+    emit finished(image);
+}
+
 ItemImageLoader::ItemImageLoader()
     : ui(NULL)
 {
@@ -113,24 +138,26 @@ ItemImageLoader::~ItemImageLoader()
     delete ui;
 }
 
-ItemWidget *ItemImageLoader::create(const QModelIndex &index, QWidget *parent) const
+ItemWidget *ItemImageLoader::create(const QModelIndex &index, const QStringList &formats,
+                                    QWidget *parent) const
 {
-    // TODO: Just check if image provided and load it in different thread.
-    QPixmap pix;
-    if ( !getPixmapFromData(index, &pix) )
+    QString mime;
+    QByteArray data;
+    if ( !getImageData(index, formats, &data, &mime) )
         return NULL;
 
-    // scale pixmap
-    const int w = m_settings.value("max_image_width", 320).toInt();
-    const int h = m_settings.value("max_image_height", 240).toInt();
-    if ( w > 0 && pix.width() > w && (h <= 0 || pix.width()/w > pix.height()/h) ) {
-        pix = pix.scaledToWidth(w);
-    } else if (h > 0 && pix.height() > h) {
-        pix = pix.scaledToHeight(h);
-    }
+    ItemImage *item = new ItemImage( m_settings.value("image_editor").toString(),
+                                     m_settings.value("svg_editor").toString(), parent );
+
+    // Decode and scale large images in background so GUI is not blocked.
+    ItemImagePreviewJob *job = new ItemImagePreviewJob(
+                data, mime,
+                m_settings.value("max_image_width", 320).toInt(),
+                m_settings.value("max_image_height", 240).toInt() );
+    connect( job, SIGNAL(finished(QImage)), item, SLOT(setImage(QImage)) );
+    QThreadPool::globalInstance()->start(job);
 
-    return new ItemImage(pix, m_settings.value("image_editor").toString(),
-                         m_settings.value("svg_editor").toString(), parent);
+    return item;
 }
 
 QStringList ItemImageLoader::formatsToSave() const
@@ -139,6 +166,11 @@ QStringList ItemImageLoader::formatsToSave() const
                                         << QString("image/jpeg") << QString("image/gif");
 }
 
+QStringList ItemImageLoader::formatsToRender() const
+{
+    return imageFormats;
+}
+
 QVariantMap ItemImageLoader::applySettings()
 {
     Q_ASSERT(ui != NULL);
@@ -22,7 +22,9 @@
 
 #include "item/itemwidget.h"
 
+#include <QImage>
 #include <QLabel>
+#include <QRunnable>
 
 namespace Ui {
 class ItemImageSettings;
@@ -33,11 +35,14 @@ class ItemImage : public QLabel, public ItemWidget
     Q_OBJECT
 
 public:
-    ItemImage(const QPixmap &pix, const QString &imageEditor, const QString &svgEditor,
-              QWidget *parent);
+    ItemImage(const QString &imageEditor, const QString &svgEditor, QWidget *parent);
 
     virtual QObject *createExternalEditor(const QModelIndex &index, QWidget *parent) const;
 
+public slots:
+    /** Show image prepared in background (see ItemImagePreviewJob). */
+    void setImage(const QImage &image);
+
 protected:
     virtual void updateSize();
 
@@ -46,6 +51,30 @@ private:
     QString m_svgEditor;
 };
 
+/**
+ * Decodes and scales image for item in worker thread.
+ *
+ * Result is passed to finished() and the job is deleted afterwards.
+ */
+class ItemImagePreviewJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    ItemImagePreviewJob(const QByteArray &data, const QString &mime, int maxWidth, int maxHeight);
+
+    virtual void run();
+
+signals:
+    void finished(const QImage &image);
+
+private:
+    QByteArray m_data;
+    QString m_mime;
+    int m_maxWidth;
+    int m_maxHeight;
+};
+
 class ItemImageLoader : public QObject, public ItemLoaderInterface
 {
     Q_OBJECT
@@ -57,7 +86,8 @@ public:
 
     ~ItemImageLoader();
 
-    virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
+    virtual ItemWidget *create(const QModelIndex &index, const QStringList &formats,
+                               QWidget *parent) const;
 
     virtual int priority() const { return 10; }
 
@@ -68,6 +98,8 @@ public:
 
     virtual QStringList formatsToSave() const;
 
+    virtual QStringList formatsToRender() const;
+
     virtual QVariantMap applySettings();
 
     virtual void loadSettings(const QVariantMap &settings) { m_settings = settings; }
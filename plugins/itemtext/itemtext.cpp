@@ -196,10 +196,9 @@ ItemTextLoader::~ItemTextLoader()
     delete ui;
 }
 
-ItemWidget *ItemTextLoader::create(const QModelIndex &index, QWidget *parent) const
+ItemWidget *ItemTextLoader::create(const QModelIndex &index, const QStringList &formats,
+                                   QWidget *parent) const
 {
-    const QStringList formats = index.data(contentType::formats).toStringList();
-
     QString text;
     bool isRichText = m_settings.value("use_rich_text", true).toBool()
             && getRichText(index, formats, &text);
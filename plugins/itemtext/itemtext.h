@@ -74,7 +74,8 @@ public:
 
     ~ItemTextLoader();
 
-    virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
+    virtual ItemWidget *create(const QModelIndex &index, const QStringList &formats,
+                               QWidget *parent) const;
 
     virtual QString id() const { return "itemtext"; }
     virtual QString name() const { return tr("Te&xt Items"); }
@@ -83,6 +84,8 @@ public:
 
     virtual QStringList formatsToSave() const;
 
+    virtual QStringList formatsToRender() const { return formatsToSave(); }
+
     virtual QVariantMap applySettings();
 
     virtual void loadSettings(const QVariantMap &settings) { m_settings = settings; }
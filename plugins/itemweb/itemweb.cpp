@@ -18,14 +18,18 @@
 */
 
 #include "itemweb.h"
+#include "ui_itemwebsettings.h"
 
 #include "common/contenttype.h"
 
 #include <QApplication>
+#include <QCryptographicHash>
 #include <QDesktopWidget>
 #include <QModelIndex>
 #include <QMouseEvent>
+#include <QPainter>
 #include <QPalette>
+#include <QTimer>
 #include <QtPlugin>
 #include <QtWebKit/QWebHistory>
 #if QT_VERSION < 0x050000
@@ -52,29 +56,54 @@ bool getHtml(const QModelIndex &index, QString *text)
     return true;
 }
 
-} // namespace
+/** Maximum size of pixmaps in cache in KiB. */
+const int snapshotCacheSize = 32 * 1024;
+
+/**
+ * Key for rendered HTML in cache.
+ *
+ * Contains digest of whole HTML (so hash collisions cannot show wrong item),
+ * width and style used for rendering.
+ */
+QByteArray snapshotCacheKey(const QString &html, int width,
+                            const QFont &font, const QPalette &palette)
+{
+    return QCryptographicHash::hash(html.toUtf8(), QCryptographicHash::Sha1)
+            + '\n' + QByteArray::number(width)
+            + '\n' + font.key().toUtf8()
+            + '\n' + QByteArray::number(palette.cacheKey());
+}
 
-ItemWeb::ItemWeb(const QString &html, QWidget *parent)
-    : QWebView(parent)
-    , ItemWidget(this)
+void initPage(QWebPage *page, const QFont &defaultFont, const QPalette &palette)
 {
-    QWebFrame *frame = page()->mainFrame();
+    QWebFrame *frame = page->mainFrame();
     frame->setScrollBarPolicy(Qt::Horizontal, Qt::ScrollBarAlwaysOff);
     frame->setScrollBarPolicy(Qt::Vertical,   Qt::ScrollBarAlwaysOff);
 
-    const QFont &defaultFont = font();
-    settings()->setFontFamily(QWebSettings::StandardFont, defaultFont.family());
+    QWebSettings *settings = page->settings();
+    settings->setFontFamily(QWebSettings::StandardFont, defaultFont.family());
     // DPI resolution can be different than the one used by this widget.
     QWidget* window = QApplication::desktop()->screen();
     int dpi = window->logicalDpiX();
     int pt = defaultFont.pointSize();
-    settings()->setFontSize(QWebSettings::DefaultFontSize, pt * dpi / 72);
+    settings->setFontSize(QWebSettings::DefaultFontSize, pt * dpi / 72);
 
-    history()->setMaximumItemCount(0);
+    page->history()->setMaximumItemCount(0);
 
-    QPalette pal(palette());
+    QPalette pal(palette);
     pal.setBrush(QPalette::Base, Qt::transparent);
-    page()->setPalette(pal);
+    page->setPalette(pal);
+}
+
+} // namespace
+
+ItemWeb::ItemWeb(const QString &html, QWidget *parent)
+    : QWebView(parent)
+    , ItemWidget(this)
+{
+    initPage( page(), font(), palette() );
+    QWebFrame *frame = page()->mainFrame();
+
     setAttribute(Qt::WA_OpaquePaintEvent, false);
 
     connect( frame, SIGNAL(loadFinished(bool)),
@@ -162,13 +191,209 @@ void ItemWeb::mouseReleaseEvent(QMouseEvent *e)
     }
 }
 
-ItemWidget *ItemWebLoader::create(const QModelIndex &index, QWidget *parent) const
+ItemWebPreview::ItemWebPreview(const QString &html, ItemWebRenderer *renderer, QWidget *parent)
+    : QWidget(parent)
+    , ItemWidget(this)
+    , m_html(html)
+    , m_renderer(renderer)
+    , m_snapshot()
+    , m_snapshotWidth(-1)
+    , m_webView(NULL)
+{
+    resize( 0, fontMetrics().lineSpacing() );
+}
+
+void ItemWebPreview::setSnapshot(const QPixmap &pix)
+{
+    if (m_webView != NULL)
+        return;
+
+    m_snapshot = pix;
+    resize( pix.size() );
+    update();
+}
+
+void ItemWebPreview::highlight(const QRegExp &re, const QFont &highlightFont,
+                               const QPalette &highlightPalette)
+{
+    // Highlighting text is possible only in live web view.
+    if (m_webView == NULL && !re.isEmpty())
+        createWebView();
+
+    if (m_webView != NULL)
+        m_webView->setHighlight(re, highlightFont, highlightPalette);
+}
+
+void ItemWebPreview::updateSize()
+{
+    if (m_webView != NULL) {
+        m_webView->setMaximumSize( maximumSize() );
+        m_webView->setMinimumWidth( minimumWidth() );
+        static_cast<ItemWidget *>(m_webView)->updateSize();
+        return;
+    }
+
+    const int w = maximumWidth();
+    if (m_snapshotWidth == w)
+        return;
+    m_snapshotWidth = w;
+
+    if ( !m_renderer.isNull() )
+        m_renderer->render(this, m_html, w);
+}
+
+void ItemWebPreview::paintEvent(QPaintEvent *)
+{
+    if ( m_webView == NULL && !m_snapshot.isNull() ) {
+        QPainter painter(this);
+        painter.drawPixmap(0, 0, m_snapshot);
+    }
+}
+
+void ItemWebPreview::mousePressEvent(QMouseEvent *e)
+{
+    if (m_webView == NULL) {
+        createWebView();
+        // Pass event to the new web view (it's propagated back to parent if ignored).
+        QCoreApplication::sendEvent(m_webView, e);
+        e->accept();
+    } else {
+        e->ignore();
+    }
+}
+
+bool ItemWebPreview::eventFilter(QObject *object, QEvent *event)
+{
+    if (object == m_webView && event->type() == QEvent::Resize)
+        resize( m_webView->size() );
+
+    return false;
+}
+
+void ItemWebPreview::createWebView()
+{
+    m_snapshot = QPixmap();
+
+    m_webView = new ItemWeb(m_html, this);
+    m_webView->setMaximumSize( maximumSize() );
+    m_webView->setMinimumWidth( minimumWidth() );
+    m_webView->installEventFilter(this);
+    static_cast<ItemWidget *>(m_webView)->updateSize();
+    m_webView->show();
+
+    resize( m_webView->size() );
+}
+
+ItemWebRenderer::ItemWebRenderer(QObject *parent)
+    : QObject(parent)
+    , m_page(new QWebPage(this))
+    , m_jobs()
+    , m_busy(false)
+    , m_cache(snapshotCacheSize)
+{
+    connect( m_page->mainFrame(), SIGNAL(loadFinished(bool)),
+             this, SLOT(onLoadFinished()) );
+}
+
+void ItemWebRenderer::render(ItemWebPreview *target, const QString &html, int width)
+{
+    const QFont font = target->font();
+    const QPalette palette = target->palette();
+    const QByteArray key = snapshotCacheKey(html, width, font, palette);
+
+    const QPixmap *pix = m_cache.object(key);
+    if (pix != NULL) {
+        target->setSnapshot(*pix);
+        return;
+    }
+
+    Job job;
+    job.target = target;
+    job.html = html;
+    job.width = width;
+    job.font = font;
+    job.palette = palette;
+    job.cacheKey = key;
+    m_jobs.append(job);
+
+    if (!m_busy)
+        renderNext();
+}
+
+void ItemWebRenderer::renderNext()
+{
+    // Skip jobs for deleted items.
+    while ( !m_jobs.isEmpty() && m_jobs.first().target.isNull() )
+        m_jobs.removeFirst();
+
+    m_busy = !m_jobs.isEmpty();
+    if (!m_busy)
+        return;
+
+    const Job &job = m_jobs.first();
+    initPage(m_page, job.font, job.palette);
+    m_page->setPreferredContentsSize( QSize(job.width, 10) );
+    m_page->mainFrame()->setHtml(job.html);
+}
+
+void ItemWebRenderer::clearCache()
+{
+    m_cache.clear();
+}
+
+void ItemWebRenderer::onLoadFinished()
+{
+    if ( m_jobs.isEmpty() )
+        return;
+
+    const Job job = m_jobs.takeFirst();
+
+    QWebFrame *frame = m_page->mainFrame();
+    const QSize size( job.width, frame->contentsSize().height() );
+    m_page->setViewportSize(size);
+
+    QPixmap *pix = new QPixmap(size);
+    pix->fill(Qt::transparent);
+    QPainter painter(pix);
+    frame->render(&painter);
+    painter.end();
+
+    if ( !job.target.isNull() )
+        job.target->setSnapshot(*pix);
+
+    const int cost = size.width() * size.height() * 4 / 1024;
+    m_cache.insert(job.cacheKey, pix, cost);
+
+    // Process next job after returning to event loop.
+    QTimer::singleShot( 0, this, SLOT(renderNext()) );
+}
+
+ItemWebLoader::ItemWebLoader()
+    : ui(NULL)
+    , m_renderer()
+{
+}
+
+ItemWebLoader::~ItemWebLoader()
+{
+    delete ui;
+    delete m_renderer.data();
+}
+
+ItemWidget *ItemWebLoader::create(const QModelIndex &index, const QStringList &,
+                                  QWidget *parent) const
 {
     QString html;
-    if ( getHtml(index, &html) )
+    if ( !getHtml(index, &html) )
+        return NULL;
+
+    if ( !m_settings.value("render_offscreen", true).toBool() )
         return new ItemWeb(html, parent);
 
-    return NULL;
+    if ( m_renderer.isNull() )
+        m_renderer = new ItemWebRenderer;
+
+    return new ItemWebPreview(html, m_renderer, parent);
 }
 
 QStringList ItemWebLoader::formatsToSave() const
@@ -176,4 +401,30 @@ QStringList ItemWebLoader::formatsToSave() const
     return QStringList("text/plain") << QString("text/html");
 }
 
+QVariantMap ItemWebLoader::applySettings()
+{
+    Q_ASSERT(ui != NULL);
+    m_settings["render_offscreen"] = ui->checkBoxRenderOffscreen->isChecked();
+    return m_settings;
+}
+
+void ItemWebLoader::loadSettings(const QVariantMap &settings)
+{
+    m_settings = settings;
+
+    // Appearance may have changed.
+    if ( !m_renderer.isNull() )
+        m_renderer->clearCache();
+}
+
+QWidget *ItemWebLoader::createSettingsWidget(QWidget *parent)
+{
+    delete ui;
+    ui = new Ui::ItemWebSettings;
+    QWidget *w = new QWidget(parent);
+    ui->setupUi(w);
+    ui->checkBoxRenderOffscreen->setChecked( m_settings.value("render_offscreen", true).toBool() );
+    return w;
+}
+
 Q_EXPORT_PLUGIN2(itemweb, ItemWebLoader)
@@ -22,12 +22,27 @@
 
 #include "item/itemwidget.h"
 
+#include <QByteArray>
+#include <QCache>
+#include <QFont>
+#include <QList>
+#include <QPalette>
+#include <QPixmap>
+#include <QPointer>
+#include <QWidget>
 #if QT_VERSION < 0x050000
 #   include <QtWebKit/QWebView>
 #else
 #   include <QtWebKitWidgets/QWebView>
 #endif
 
+class ItemWebRenderer;
+class QWebPage;
+
+namespace Ui {
+class ItemWebSettings;
+}
+
 class ItemWeb : public QWebView, public ItemWidget
 {
     Q_OBJECT
@@ -58,6 +73,89 @@ private slots:
     void onItemChanged();
 };
 
+/**
+ * Item showing HTML rendered to pixmap by shared ItemWebRenderer.
+ *
+ * Live web view (ItemWeb) is created only if user interacts with the item
+ * (mouse click) or if search text needs to be highlighted.
+ */
+class ItemWebPreview : public QWidget, public ItemWidget
+{
+    Q_OBJECT
+
+public:
+    ItemWebPreview(const QString &html, ItemWebRenderer *renderer, QWidget *parent);
+
+    /** Set pixmap with rendered HTML (called by renderer). */
+    void setSnapshot(const QPixmap &pix);
+
+protected:
+    void highlight(const QRegExp &re, const QFont &highlightFont,
+                   const QPalette &highlightPalette);
+
+    virtual void updateSize();
+
+    virtual void paintEvent(QPaintEvent *e);
+
+    virtual void mousePressEvent(QMouseEvent *e);
+
+    virtual bool eventFilter(QObject *object, QEvent *event);
+
+private:
+    /** Replace snapshot with live web view. */
+    void createWebView();
+
+    QString m_html;
+    QPointer<ItemWebRenderer> m_renderer;
+    QPixmap m_snapshot;
+    int m_snapshotWidth;
+    ItemWeb *m_webView;
+};
+
+/**
+ * Renders HTML items into pixmaps using single shared web page.
+ *
+ * Requests are queued and processed one at a time. Rendered pixmaps are cached
+ * by HTML, width, font and palette so each item is rendered only once for
+ * current width and style.
+ */
+class ItemWebRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ItemWebRenderer(QObject *parent = NULL);
+
+    /**
+     * Render @a html with given @a width and pass the result to @a target.
+     *
+     * Font and palette of @a target are used for rendering.
+     */
+    void render(ItemWebPreview *target, const QString &html, int width);
+
+    /** Remove all rendered pixmaps. */
+    void clearCache();
+
+private slots:
+    void renderNext();
+    void onLoadFinished();
+
+private:
+    struct Job {
+        QPointer<ItemWebPreview> target;
+        QString html;
+        int width;
+        QFont font;
+        QPalette palette;
+        QByteArray cacheKey;
+    };
+
+    QWebPage *m_page;
+    QList<Job> m_jobs;
+    bool m_busy;
+    QCache<QByteArray, QPixmap> m_cache;
+};
+
 class ItemWebLoader : public QObject, public ItemLoaderInterface
 {
     Q_OBJECT
@@ -65,7 +163,12 @@ class ItemWebLoader : public QObject, public ItemLoaderInterface
     Q_INTERFACES(ItemLoaderInterface)
 
 public:
-    virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
+    ItemWebLoader();
+
+    ~ItemWebLoader();
+
+    virtual ItemWidget *create(const QModelIndex &index, const QStringList &formats,
+                               QWidget *parent) const;
 
     virtual int priority() const { return 10; }
 
@@ -75,6 +178,19 @@ public:
     virtual QString description() const { return tr("Display web pages."); }
 
     virtual QStringList formatsToSave() const;
+
+    virtual QStringList formatsToRender() const { return QStringList("text/html"); }
+
+    virtual QVariantMap applySettings();
+
+    virtual void loadSettings(const QVariantMap &settings);
+
+    virtual QWidget *createSettingsWidget(QWidget *parent);
+
+private:
+    QVariantMap m_settings;
+    Ui::ItemWebSettings *ui;
+    mutable QPointer<ItemWebRenderer> m_renderer;
 };
 
 #endif // ITEMWEB_H
@@ -6,6 +6,7 @@ equals(WITH_WEBKIT,0) {
 
     HEADERS += itemweb.h
     SOURCES += itemweb.cpp
+    FORMS   += itemwebsettings.ui
     TARGET   = $$qtLibraryTarget(itemweb)
 
     lessThan(QT_MAJOR_VERSION, 5) {
@@ -0,0 +1,66 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "argumentreceiver.h"
+
+#include "common/client_server.h"
+
+#include <QLocalSocket>
+
+ArgumentReceiver::ArgumentReceiver(QLocalSocket *client, const Arguments &args, int index)
+    : QObject(client)
+    , m_client(client)
+    , m_args(args)
+    , m_index(index)
+    , m_data()
+{
+    connect( m_client, SIGNAL(readyRead()),
+             this, SLOT(readChunks()) );
+    connect( m_client, SIGNAL(disconnected()),
+             this, SLOT(onClientDisconnected()) );
+}
+
+void ArgumentReceiver::readChunks()
+{
+    QByteArray chunk;
+    while ( canReadMessage(m_client) ) {
+        if ( !readMessage(m_client, &chunk) ) {
+            log( tr("Cannot read message from client!"), LogError );
+            m_client->abort();
+            return;
+        }
+
+        if ( chunk.isEmpty() ) {
+            disconnect( m_client, NULL, this, NULL );
+            m_args.replace(m_index, m_data);
+            m_data.clear();
+            emit received(m_args, m_client);
+            deleteLater();
+            return;
+        }
+
+        m_data.append(chunk);
+    }
+}
+
+void ArgumentReceiver::onClientDisconnected()
+{
+    // No command is running for the client so socket can be deleted.
+    m_client->deleteLater();
+}
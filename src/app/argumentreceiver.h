@@ -0,0 +1,67 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARGUMENTRECEIVER_H
+#define ARGUMENTRECEIVER_H
+
+#include "common/arguments.h"
+
+#include <QByteArray>
+#include <QObject>
+
+class QLocalSocket;
+
+/**
+ * Receives argument which client streams in chunks (e.g. data from standard
+ * input for "copyq write ... -").
+ *
+ * Each chunk is sent in separate message and empty message ends the argument.
+ * Chunks are appended directly to the argument data so the whole argument is
+ * never held in more than one buffer and GUI thread doesn't wait for client.
+ *
+ * Object is destroyed with the client socket or after received() is emitted.
+ */
+class ArgumentReceiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** Receive argument at @a index for command @a args from @a client. */
+    ArgumentReceiver(QLocalSocket *client, const Arguments &args, int index);
+
+signals:
+    /** Whole argument was received. */
+    void received(const Arguments &args, QLocalSocket *client);
+
+public slots:
+    /** Read all chunks received from client. */
+    void readChunks();
+
+private slots:
+    /** Client disconnected before whole argument was received. */
+    void onClientDisconnected();
+
+private:
+    QLocalSocket *m_client;
+    Arguments m_args;
+    int m_index;
+    QByteArray m_data;
+};
+
+#endif // ARGUMENTRECEIVER_H
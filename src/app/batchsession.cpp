@@ -0,0 +1,92 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "batchsession.h"
+
+#include "common/client_server.h"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QLocalSocket>
+
+BatchSession::BatchSession(QLocalSocket *client)
+    : QObject(client)
+    , m_client(client)
+    , m_requests()
+    , m_running(false)
+{
+    connect( m_client, SIGNAL(readyRead()),
+             this, SLOT(readRequests()) );
+}
+
+bool BatchSession::isBatchCommand(const Arguments &args)
+{
+    return args.length() == Arguments::Rest + 1 && args.at(Arguments::Rest) == "batch";
+}
+
+QByteArray BatchSession::createRequest(int requestId, const Arguments &args)
+{
+    QByteArray msg;
+    QDataStream out(&msg, QIODevice::WriteOnly);
+    out << requestId << args;
+    return msg;
+}
+
+void BatchSession::readRequests()
+{
+    // Read only complete messages so GUI thread doesn't wait for client.
+    while ( canReadMessage(m_client) ) {
+        QByteArray msg;
+        if ( !readMessage(m_client, &msg) ) {
+            log( tr("Cannot read message from client!"), LogError );
+            m_client->abort();
+            return;
+        }
+
+        int requestId;
+        Arguments args;
+        QDataStream in(msg);
+        in >> requestId >> args;
+        m_requests.enqueue( qMakePair(requestId, args) );
+    }
+
+    if (!m_running)
+        startNextCommand();
+}
+
+void BatchSession::commandFinished()
+{
+    m_running = false;
+    startNextCommand();
+}
+
+void BatchSession::startNextCommand()
+{
+    if ( m_requests.isEmpty() )
+        return;
+
+    if ( m_client->state() != QLocalSocket::ConnectedState ) {
+        m_requests.clear();
+        return;
+    }
+
+    m_running = true;
+    const QPair<int, Arguments> request = m_requests.dequeue();
+    emit commandRequested(this, request.second, request.first);
+}
@@ -0,0 +1,80 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BATCHSESSION_H
+#define BATCHSESSION_H
+
+#include "common/arguments.h"
+
+#include <QObject>
+#include <QPair>
+#include <QQueue>
+
+class QByteArray;
+class QLocalSocket;
+
+/**
+ * Serves multiple commands sent by client over single connection.
+ *
+ * Client starts the session with "batch" command and then sends each command
+ * in separate message containing request ID followed by Arguments.
+ *
+ * Commands are queued and started one after another (next command starts
+ * when commandFinished() is called) so they are executed in order they were
+ * sent. Client doesn't need to wait for responses before sending next command.
+ * Each response message for the command contains exit code followed by the
+ * request ID (see ClipboardServer::sendMessage()).
+ *
+ * Object is destroyed with the client socket.
+ */
+class BatchSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BatchSession(QLocalSocket *client);
+
+    /** Return true if @a args start new session. */
+    static bool isBatchCommand(const Arguments &args);
+
+    /** Create message with command for server. */
+    static QByteArray createRequest(int requestId, const Arguments &args);
+
+    QLocalSocket *client() const { return m_client; }
+
+signals:
+    /** Command should be started. Call commandFinished() after it finishes. */
+    void commandRequested(BatchSession *session, const Arguments &args, int requestId);
+
+public slots:
+    /** Read all commands received from client. */
+    void readRequests();
+
+    /** Current command finished; start next one. */
+    void commandFinished();
+
+private:
+    void startNextCommand();
+
+    QLocalSocket *m_client;
+    QQueue< QPair<int, Arguments> > m_requests;
+    bool m_running;
+};
+
+#endif // BATCHSESSION_H
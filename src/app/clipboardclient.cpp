@@ -19,19 +19,52 @@
 
 #include "clipboardclient.h"
 
+#include "app/batchsession.h"
 #include "common/arguments.h"
 #include "common/client_server.h"
 #include "platform/platformnativeinterface.h"
 
 #include <QCoreApplication>
 #include <QFile>
+#include <QMetaObject>
+
+namespace {
+
+/// Size of chunks of standard input data sent to server.
+const qint64 stdinChunkSize = 1024 * 1024;
+
+/// Maximum size of standard input data waiting to be sent to server.
+const qint64 maxPendingStdinBytes = 4 * 1024 * 1024;
+
+/// Maximum number of commands sent to server in batch mode before waiting for them to finish.
+const int maxPendingBatchRequests = 64;
+
+bool isBatchMode(const Arguments &args)
+{
+    return (args.length() == Arguments::Rest + 1 || args.length() == Arguments::Rest + 2)
+            && args.at(Arguments::Rest) == "batch";
+}
+
+} // namespace
 
 ClipboardClient::ClipboardClient(int &argc, char **argv, int skipArgc, const QString &sessionName)
     : QObject()
     , App(new QCoreApplication(argc, argv), sessionName)
     , m_client()
     , m_args(argc, argv, skipArgc + 1)
+    , m_batch( isBatchMode(m_args) )
+    , m_batchInput()
+    , m_lastRequestId(0)
+    , m_pendingRequests()
+    , m_batchInputFinished(false)
+    , m_batchInputPaused(false)
+    , m_batchExitCode(0)
 {
+    if ( m_batch && !startBatch() ) {
+        exit(1);
+        return;
+    }
+
     // client socket
     connect( &m_client, SIGNAL(readyRead()),
              this, SLOT(readyRead()) );
@@ -53,10 +86,26 @@ void ClipboardClient::sendMessage()
     {
         QByteArray msg;
         QDataStream out(&msg, QIODevice::WriteOnly);
-        out << m_args;
+        if (m_batch) {
+            Arguments args;
+            args.append("batch");
+            out << args;
+        } else {
+            out << m_args;
+            if (m_args.stdinArgument() != -1)
+                out << m_args.stdinArgument();
+        }
         writeMessage(&m_client, msg);
     }
 
+    if (m_batch) {
+        sendBatchCommand();
+    } else if ( m_args.stdinArgument() != -1 && !sendStandardInput() ) {
+        log( tr("Cannot send standard input to server!"), LogError );
+        exit(1);
+        return;
+    }
+
     COPYQ_LOG("Message send to server.");
 }
 
@@ -65,6 +114,7 @@ void ClipboardClient::readyRead()
     COPYQ_LOG("Receiving message from server.");
 
     int exitCode, i, len;
+    int requestId = -1;
     QByteArray msg;
     while ( m_client.bytesAvailable() ) {
         if( !readMessage(&m_client, &msg) )
@@ -74,6 +124,11 @@ void ClipboardClient::readyRead()
         in >> exitCode;
         i = sizeof(exitCode);
 
+        if (m_batch) {
+            in >> requestId;
+            i += sizeof(requestId);
+        }
+
         len = msg.length();
         if (len > i) {
             if (exitCode == CommandActivateWindow) {
@@ -89,6 +144,20 @@ void ClipboardClient::readyRead()
 
         COPYQ_LOG( QString("Message received with exit code %1.").arg(exitCode) );
 
+        if (m_batch && exitCode != CommandExit) {
+            if (exitCode == CommandBadSyntax || exitCode == CommandError) {
+                m_batchExitCode = exitCode;
+            } else if (exitCode == CommandFinished) {
+                m_pendingRequests.remove(requestId);
+                if (m_batchInputPaused) {
+                    m_batchInputPaused = false;
+                    QMetaObject::invokeMethod(this, "sendBatchCommand", Qt::QueuedConnection);
+                }
+                finishBatch();
+            }
+            continue;
+        }
+
         if (exitCode == CommandFinished || exitCode == CommandBadSyntax || exitCode == CommandError) {
             exit(exitCode);
             break;
@@ -100,6 +169,81 @@ void ClipboardClient::readyRead()
     }
 }
 
+void ClipboardClient::sendBatchCommand()
+{
+    if (m_batchInputFinished)
+        return;
+
+    if (m_pendingRequests.size() >= maxPendingBatchRequests) {
+        m_batchInputPaused = true;
+        return;
+    }
+
+    const QByteArray line = m_batchInput.readLine();
+    if ( line.isEmpty() ) {
+        m_batchInputFinished = true;
+        finishBatch();
+        return;
+    }
+
+    // Skip empty lines and comments.
+    const Arguments args(line);
+    if ( args.length() > Arguments::Rest && !line.trimmed().startsWith('#') ) {
+        const int requestId = ++m_lastRequestId;
+        m_pendingRequests.insert(requestId);
+        writeMessage( &m_client, BatchSession::createRequest(requestId, args) );
+    }
+
+    // Handle responses from server before reading next command.
+    QMetaObject::invokeMethod(this, "sendBatchCommand", Qt::QueuedConnection);
+}
+
+bool ClipboardClient::sendStandardInput()
+{
+    QFile in;
+    if ( !in.open(stdin, QIODevice::ReadOnly) )
+        return false;
+
+    // Send data in chunks (empty chunk is last) and don't buffer more than
+    // server can receive.
+    QByteArray chunk;
+    do {
+        chunk = in.read(stdinChunkSize);
+        writeMessage(&m_client, chunk);
+        while ( m_client.bytesToWrite() > maxPendingStdinBytes ) {
+            if ( !m_client.waitForBytesWritten(-1) )
+                return false;
+        }
+    } while ( !chunk.isEmpty() );
+
+    return true;
+}
+
+bool ClipboardClient::startBatch()
+{
+    if ( m_args.length() == Arguments::Rest + 2
+         && m_args.stdinArgument() != Arguments::Rest + 1 )
+    {
+        const QString fileName = QString::fromUtf8( m_args.at(Arguments::Rest + 1) );
+        m_batchInput.setFileName(fileName);
+        if ( !m_batchInput.open(QIODevice::ReadOnly) ) {
+            log( tr("Cannot open file \"%1\"!").arg(fileName), LogError );
+            return false;
+        }
+    } else if ( !m_batchInput.open(stdin, QIODevice::ReadOnly) ) {
+        log( tr("Cannot read standard input!"), LogError );
+        return false;
+    }
+
+    return true;
+}
+
+void ClipboardClient::finishBatch()
+{
+    if ( m_batchInputFinished && m_pendingRequests.isEmpty() )
+        exit(m_batchExitCode);
+}
+
 void ClipboardClient::readFinnished()
 {
     exit();
@@ -23,7 +23,9 @@
 #include "app.h"
 #include "common/arguments.h"
 
+#include <QFile>
 #include <QLocalSocket>
+#include <QSet>
 
 /**
  * Application client.
@@ -32,6 +34,11 @@
  * Exit code is same as exit code send by ClipboardServer::sendMessage().
  * Also the received message is printed on standard output (if exit code is
  * zero) or standard error output.
+ *
+ * In batch mode ("batch" command) commands are read line by line from standard
+ * input or given file and sent to server over single connection without
+ * waiting for previous commands to finish. Exit code is non-zero if any
+ * command failed.
  */
 class ClipboardClient : public QObject, public App
 {
@@ -42,12 +49,33 @@ public:
                     int skipArgc = 0, const QString &sessionName = QString());
 
 private:
+    /** Stream standard input for argument "-" to server; return false on error. */
+    bool sendStandardInput();
+
+    /** Start batch mode; return false on error. */
+    bool startBatch();
+
+    /** Exit if batch input is finished and all commands finished. */
+    void finishBatch();
+
     QLocalSocket m_client;
     Arguments m_args;
 
+    bool m_batch;
+    QFile m_batchInput;
+    int m_lastRequestId;
+    QSet<int> m_pendingRequests;
+    bool m_batchInputFinished;
+    bool m_batchInputPaused;
+    int m_batchExitCode;
+
 private slots:
     void sendMessage();
     void readyRead();
+
+    /** Read next command from batch input and send it to server. */
+    void sendBatchCommand();
+
     void readFinnished();
     void error(QLocalSocket::LocalSocketError);
 };
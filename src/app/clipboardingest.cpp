@@ -0,0 +1,147 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "clipboardingest.h"
+
+#include "common/client_server.h"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QMimeData>
+#include <QMutexLocker>
+#include <QRunnable>
+
+namespace {
+
+class IngestJob : public QRunnable
+{
+public:
+    IngestJob(ClipboardIngest *ingest, const QByteArray &message,
+              const QSharedPointer<CommandMatcher> &commandMatcher)
+        : m_ingest(ingest)
+        , m_message(message)
+        , m_commandMatcher(commandMatcher)
+    {
+        m_receiveTime.start();
+    }
+
+    void run()
+    {
+        IngestedData result;
+        result.receiveTime = m_receiveTime;
+
+        QMimeData data;
+        if ( deserializeData(&data, m_message) ) {
+            m_message.clear();
+
+            // Store only formats which would be saved in history.
+            result.data = cloneData(data);
+            result.dataHash = hash( *result.data, result.data->formats() );
+
+            if ( result.data->hasText() )
+                result.text = result.data->text();
+            result.commands = m_commandMatcher->match(*result.data, result.text);
+
+            // Data are owned by GUI thread from now on.
+            result.data->moveToThread( m_ingest->thread() );
+        }
+
+        m_ingest->addResult(result);
+    }
+
+private:
+    ClipboardIngest *m_ingest;
+    QByteArray m_message;
+    QSharedPointer<CommandMatcher> m_commandMatcher;
+    QElapsedTimer m_receiveTime;
+};
+
+} // namespace
+
+ClipboardIngest::ClipboardIngest(QObject *parent)
+    : QObject(parent)
+    , m_pool()
+    , m_commandMatcher(new CommandMatcher)
+    , m_resultsMutex()
+    , m_results()
+{
+    // Single thread keeps order of messages and command matcher isn't used concurrently.
+    m_pool.setMaxThreadCount(1);
+}
+
+ClipboardIngest::~ClipboardIngest()
+{
+    m_pool.waitForDone();
+
+    foreach (const IngestedData &result, m_results)
+        delete result.data;
+}
+
+void ClipboardIngest::setCommands(const QList<Command> &commands)
+{
+    // Pending messages keep using previous commands.
+    m_commandMatcher = QSharedPointer<CommandMatcher>(new CommandMatcher);
+    m_commandMatcher->setCommands(commands);
+}
+
+QVariantMap ClipboardIngest::commandStats() const
+{
+    return m_commandMatcher->stats();
+}
+
+bool ClipboardIngest::isControlMessage(const QByteArray &message)
+{
+    QDataStream in(message);
+
+    qint32 length;
+    in >> length;
+    if ( in.status() != QDataStream::Ok || length != 1 )
+        return false;
+
+    QString mime;
+    in >> mime;
+    return in.status() == QDataStream::Ok
+            && (mime == mimeMonitorPong || mime == mimeMonitorStats);
+}
+
+void ClipboardIngest::addMessage(const QByteArray &message)
+{
+    m_pool.start( new IngestJob(this, message, m_commandMatcher) );
+}
+
+void ClipboardIngest::addResult(const IngestedData &result)
+{
+    QMutexLocker lock(&m_resultsMutex);
+    m_results.append(result);
+    if ( m_results.size() == 1 )
+        QMetaObject::invokeMethod(this, "processResults", Qt::QueuedConnection);
+}
+
+void ClipboardIngest::processResults()
+{
+    QList<IngestedData> results;
+    {
+        QMutexLocker lock(&m_resultsMutex);
+        results = m_results;
+        m_results.clear();
+    }
+
+    foreach (const IngestedData &result, results)
+        emit ingested(result);
+}
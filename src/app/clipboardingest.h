@@ -0,0 +1,125 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLIPBOARDINGEST_H
+#define CLIPBOARDINGEST_H
+
+#include "common/command.h"
+#include "common/commandmatcher.h"
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QThreadPool>
+#include <QVariantMap>
+
+class QByteArray;
+class QMimeData;
+
+/**
+ * Message from monitor decoded and prepared for adding to history.
+ */
+struct IngestedData {
+    IngestedData()
+        : data(NULL)
+        , dataHash(0)
+        , text()
+        , commands()
+        , receiveTime()
+        {}
+
+    /**
+     * Decoded data (NULL if message is corrupted).
+     *
+     * Contains only formats copied by cloneData().
+     */
+    QMimeData *data;
+
+    /** Hash of the data. */
+    uint dataHash;
+
+    /** Text of the data. */
+    QString text;
+
+    /** Automatic commands matching the data. */
+    QList<Command> commands;
+
+    /** Started when message was received. */
+    QElapsedTimer receiveTime;
+};
+
+/**
+ * Prepares clipboard data received from monitor in a worker thread.
+ *
+ * Messages are decoded, hashed and matched against automatic commands in
+ * background so that only adding the item to history needs to be done in GUI
+ * thread. Results are passed to ingested() in same order as messages were
+ * added.
+ */
+class ClipboardIngest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ClipboardIngest(QObject *parent = NULL);
+
+    /** Wait for pending messages and delete unprocessed data. */
+    ~ClipboardIngest();
+
+    /** Set commands to match new data against (only automatic are used). */
+    void setCommands(const QList<Command> &commands);
+
+    /** Return statistics for matching commands (see CommandMatcher::stats()). */
+    QVariantMap commandStats() const;
+
+    /**
+     * Return true if @a message from monitor is heartbeat reply or statistics.
+     *
+     * Only header of the message is read. Such messages should be handled
+     * directly so they are not delayed by clipboard data waiting in queue.
+     */
+    static bool isControlMessage(const QByteArray &message);
+
+    /** Process new @a message from monitor in background. */
+    void addMessage(const QByteArray &message);
+
+    /** Pass processed message to GUI thread (called from worker thread). */
+    void addResult(const IngestedData &result);
+
+signals:
+    /**
+     * Message was processed.
+     *
+     * Receiver takes ownership of @a ingested data.
+     */
+    void ingested(const IngestedData &ingested);
+
+private slots:
+    void processResults();
+
+private:
+    QThreadPool m_pool;
+    QSharedPointer<CommandMatcher> m_commandMatcher;
+    QMutex m_resultsMutex;
+    QList<IngestedData> m_results;
+};
+
+#endif // CLIPBOARDINGEST_H
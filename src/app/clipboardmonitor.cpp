@@ -20,19 +20,75 @@
 #include "clipboardmonitor.h"
 
 #include "common/client_server.h"
-#include "item/clipboarditem.h"
 #include "platform/platformnativeinterface.h"
 
 #include <QApplication>
 #include <QMimeData>
+#include <QSocketNotifier>
 #include <QTimer>
 
 #ifdef COPYQ_WS_X11
 #  include "platform/x11/x11platform.h"
+#  include "platform/x11/x11selectionreader.h"
 #endif
 
 namespace {
 
+/// Minimal interval (in ms) between clipboard checks or updates in a burst of changes.
+const int minUpdateIntervalMs = 20;
+
+/// Maximal interval (in ms) between clipboard checks or updates in a burst of changes.
+const int maxUpdateIntervalMs = 1000;
+
+/// Interval (in ms) for sending statistics to server after a change.
+const int statsIntervalMs = 1000;
+
+#ifdef COPYQ_WS_X11
+/// Maximum size of data (in bytes) for single format retrieved in background.
+const qint64 maxSelectionSize = Q_INT64_C(256) * 1024 * 1024;
+#else
+/// If retrieving a format takes longer (in ms), other expensive formats are skipped.
+const int formatTimeoutMs = 1000;
+
+/**
+ * Return true if format should be retrieved immediately.
+ *
+ * Text is usually small and quickly converted by clipboard owner unlike images
+ * and application specific formats.
+ */
+bool isCheapFormat(const QString &format)
+{
+    return format.startsWith("text/");
+}
+#endif
+
+/**
+ * Return @a formats which are available in @a data.
+ *
+ * List of available formats is retrieved only once (from TARGETS on X11)
+ * so no data conversion is requested for formats the owner doesn't provide.
+ */
+QStringList availableFormats(const QMimeData &data, const QStringList &formats)
+{
+    const QStringList available = data.formats();
+    QStringList result;
+    foreach (const QString &format, formats) {
+        if ( available.contains(format) )
+            result.append(format);
+    }
+    return result;
+}
+
+/**
+ * Double the timer interval if events keep coming (@a burst is true),
+ * otherwise reset it to the minimum.
+ */
+void updateThrottleInterval(QTimer *timer, bool burst)
+{
+    timer->setInterval( burst ? qMin(timer->interval() * 2, maxUpdateIntervalMs)
+                              : minUpdateIntervalMs );
+}
+
 void setClipboardData(QMimeData *data, QClipboard::Mode mode)
 {
     Q_ASSERT( isMainThread() );
@@ -53,15 +109,22 @@ public:
         , m_syncTimer()
         , m_syncData(NULL)
         , m_syncTo(QClipboard::Clipboard)
+        , m_inputNotifier(NULL)
     {
         m_timer.setSingleShot(true);
-        m_timer.setInterval(100);
         m_syncTimer.setSingleShot(true);
         m_syncTimer.setInterval(100);
+
+        const int fd = m_dsp.connectionNumber();
+        if (fd != -1) {
+            m_inputNotifier = new QSocketNotifier(fd, QSocketNotifier::Read);
+            m_inputNotifier->setEnabled(false);
+        }
     }
 
     ~PrivateX11()
     {
+        delete m_inputNotifier;
         delete m_syncData;
     }
 
@@ -70,12 +133,36 @@ public:
         if (m_timer.isActive())
             return true;
 
-        if ( m_dsp.isSelecting() ) {
-            m_timer.start();
-            return true;
+        if ( !m_dsp.isSelecting() ) {
+            stopWatchingInputRelease();
+            return false;
         }
 
-        return false;
+        // Wait for mouse button or key release event if possible and check
+        // selection only rarely in case an event is missed.
+        if ( m_inputNotifier != NULL && m_dsp.startWatchingInputRelease() ) {
+            m_inputNotifier->setEnabled(true);
+            m_timer.start(1000);
+        } else {
+            m_timer.start(100);
+        }
+
+        return true;
+    }
+
+    /**
+     * Return true if mouse button or key was released while waiting in
+     * waitForKeyRelease().
+     */
+    bool inputReleased()
+    {
+        // Always process events so the socket notifier is not triggered again.
+        if ( !m_dsp.hasInputReleased() || !m_timer.isActive() )
+            return false;
+
+        m_timer.stop();
+        stopWatchingInputRelease();
+        return true;
     }
 
     const QTimer &timer() const
@@ -83,6 +170,11 @@ public:
         return m_timer;
     }
 
+    const QSocketNotifier *inputNotifier() const
+    {
+        return m_inputNotifier;
+    }
+
     const QTimer &syncTimer() const
     {
         return m_syncTimer;
@@ -99,6 +191,7 @@ public:
     void synchronize(QMimeData *data, QClipboard::Mode modeSyncTo)
     {
         delete m_syncData;
+        // Payload bytes are shared with data sent to server.
         m_syncData = cloneData(*data);
         m_syncTo = modeSyncTo;
         m_syncTimer.start();
@@ -124,12 +217,25 @@ public:
         return !m_syncTimer.isActive() && m_syncData != NULL;
     }
 
+    WId selectionOwner(QClipboard::Mode mode)
+    {
+        return m_dsp.selectionOwner(mode == QClipboard::Selection);
+    }
+
 private:
+    void stopWatchingInputRelease()
+    {
+        if (m_inputNotifier != NULL)
+            m_inputNotifier->setEnabled(false);
+        m_dsp.stopWatchingInputRelease();
+    }
+
     X11Platform m_dsp;
     QTimer m_timer;
     QTimer m_syncTimer;
     QMimeData *m_syncData;
     QClipboard::Mode m_syncTo;
+    QSocketNotifier *m_inputNotifier;
 };
 #endif
 
@@ -146,11 +252,33 @@ ClipboardMonitor::ClipboardMonitor(int &argc, char **argv)
     , m_socket( new QLocalSocket(this) )
     , m_updateTimer( new QTimer(this) )
     , m_needCheckClipboard(false)
+    , m_clipboardChangeTime()
+    , m_setClipboardTimer( new QTimer(this) )
+    , m_newDataTime()
+    , m_checkLatency()
+    , m_setLatency()
+    , m_coalescedChanges(0)
+    , m_statsTimer( new QTimer(this) )
+    , m_fetchData()
+    , m_fetchMode(QClipboard::Clipboard)
+    , m_fetchFormats()
+    , m_fetchChangeTime()
+    , m_fetchTimer( new QTimer(this) )
 #ifdef COPYQ_WS_X11
     , m_needCheckSelection(false)
+    , m_selectionChangeTime()
+    , m_selectionReader(NULL)
+    , m_fetchOwner(0)
+    , m_fetchTimestamp(0)
     , m_x11(new PrivateX11)
 #endif
 {
+    m_clipboardChangeTime.invalidate();
+    m_newDataTime.invalidate();
+#ifdef COPYQ_WS_X11
+    m_selectionChangeTime.invalidate();
+#endif
+
     connect( m_socket, SIGNAL(readyRead()),
              this, SLOT(readyRead()), Qt::DirectConnection );
     connect( m_socket, SIGNAL(disconnected()),
@@ -169,13 +297,32 @@ ClipboardMonitor::ClipboardMonitor(int &argc, char **argv)
     COPYQ_LOG("Connected to server.");
 
     m_updateTimer->setSingleShot(true);
-    m_updateTimer->setInterval(300);
+    m_updateTimer->setInterval(minUpdateIntervalMs);
     connect( m_updateTimer, SIGNAL(timeout()),
              this, SLOT(updateTimeout()));
 
+    m_setClipboardTimer->setSingleShot(true);
+    m_setClipboardTimer->setInterval(minUpdateIntervalMs);
+    connect( m_setClipboardTimer, SIGNAL(timeout()),
+             this, SLOT(setClipboardTimeout()));
+
+    m_statsTimer->setSingleShot(true);
+    m_statsTimer->setInterval(statsIntervalMs);
+    connect( m_statsTimer, SIGNAL(timeout()),
+             this, SLOT(sendStats()));
+
+    m_fetchTimer->setSingleShot(true);
+    m_fetchTimer->setInterval(0);
+    connect( m_fetchTimer, SIGNAL(timeout()),
+             this, SLOT(fetchTimeout()));
+
 #ifdef COPYQ_WS_X11
     connect( &m_x11->timer(), SIGNAL(timeout()),
              this, SLOT(updateSelection()) );
+    if ( m_x11->inputNotifier() != NULL ) {
+        connect( m_x11->inputNotifier(), SIGNAL(activated(int)),
+                 this, SLOT(onX11InputEvent()) );
+    }
     connect( &m_x11->syncTimer(), SIGNAL(timeout()),
              this, SLOT(synchronize()) );
 #endif
@@ -183,6 +330,7 @@ ClipboardMonitor::ClipboardMonitor(int &argc, char **argv)
 
 ClipboardMonitor::~ClipboardMonitor()
 {
+    abortFetching();
 #ifdef COPYQ_WS_X11
     delete m_x11;
 #endif
@@ -202,6 +350,14 @@ bool ClipboardMonitor::updateSelection(bool check)
 }
 #endif
 
+#ifdef COPYQ_WS_X11
+void ClipboardMonitor::onX11InputEvent()
+{
+    if ( m_x11->inputReleased() )
+        updateSelection();
+}
+#endif
+
 #ifdef COPYQ_WS_X11
 void ClipboardMonitor::synchronize()
 {
@@ -217,8 +373,24 @@ void ClipboardMonitor::checkClipboard(QClipboard::Mode mode)
     m_x11->synchronizeNone();
 #endif
 
+    // Content being retrieved is outdated.
+    if ( isFetching() && m_fetchMode == mode )
+        abortFetching();
+
+#ifdef COPYQ_WS_X11
+    QElapsedTimer &changeTime = (mode == QClipboard::Clipboard) ? m_clipboardChangeTime
+                                                                : m_selectionChangeTime;
+#else
+    QElapsedTimer &changeTime = m_clipboardChangeTime;
+#endif
+    if ( !changeTime.isValid() )
+        changeTime.start();
+
     // Check clipboard after interval because someone is updating it very quickly.
-    bool needToWait = m_updateTimer->isActive();
+    // Timer is not restarted so the last change in a burst is not postponed indefinitely.
+    // Content of the other mode is being retrieved in background so check later
+    // (see finishFetching()).
+    bool needToWait = m_updateTimer->isActive() || isFetching();
     if (mode == QClipboard::Clipboard)
         m_needCheckClipboard = needToWait;
 #ifdef COPYQ_WS_X11
@@ -226,9 +398,15 @@ void ClipboardMonitor::checkClipboard(QClipboard::Mode mode)
         m_needCheckSelection = needToWait;
 #endif
 
-    m_updateTimer->start();
-    if (needToWait)
+    if (needToWait) {
+        ++m_coalescedChanges;
         return;
+    }
+
+    m_updateTimer->start();
+
+    const QElapsedTimer firstChangeTime = changeTime;
+    changeTime.invalidate();
 
     COPYQ_LOG( QString("Checking for new %1 content.")
                .arg(mode == QClipboard::Clipboard ? "clipboard" : "selection") );
@@ -261,13 +439,119 @@ void ClipboardMonitor::checkClipboard(QClipboard::Mode mode)
         return;
     }
 
-    // clone only mime types defined by user
-    QMimeData *data2 = cloneData(*data, &m_formats);
-
     // add window title of clipboard owner
     PlatformPtr platform = createPlatformNativeInterface();
-    data2->setData( QString(mimeWindowTitle),
-                    platform->getWindowTitle(platform->getCurrentWindow()).toUtf8() );
+    m_fetchData.reset(new QMimeData);
+    m_fetchData->setData( QString(mimeWindowTitle),
+                          platform->getWindowTitle(platform->getCurrentWindow()).toUtf8() );
+
+    // retrieve only available formats requested by server
+    m_fetchMode = mode;
+    m_fetchFormats = availableFormats(*data, m_formats);
+    m_fetchChangeTime = firstChangeTime;
+
+#ifdef COPYQ_WS_X11
+    // Timestamp is retrieved with first format (see takeSelectionReaderData()).
+    m_fetchOwner = m_x11->selectionOwner(mode);
+    m_fetchTimestamp = 0;
+#endif
+
+#ifndef COPYQ_WS_X11
+    foreach ( const QString &format, m_fetchFormats ) {
+        if ( isCheapFormat(format) )
+            fetchFormat(*data, format);
+    }
+#endif
+
+    // Retrieve formats later so monitor can process other events.
+    if ( m_fetchFormats.isEmpty() )
+        finishFetching();
+    else
+        m_fetchTimer->start();
+}
+
+#ifndef COPYQ_WS_X11
+bool ClipboardMonitor::fetchFormat(const QMimeData &data, const QString &format)
+{
+    m_fetchFormats.removeOne(format);
+
+    QElapsedTimer t;
+    t.start();
+    const QByteArray bytes = data.data(format);
+    if ( !bytes.isEmpty() )
+        m_fetchData->setData(format, bytes);
+
+    if ( t.elapsed() > formatTimeoutMs ) {
+        // Skip other expensive formats.
+        QStringList skipped;
+        foreach ( const QString &format, m_fetchFormats ) {
+            if ( !isCheapFormat(format) )
+                skipped.append(format);
+        }
+
+        if ( !skipped.isEmpty() ) {
+            log( tr("Clipboard owner is too slow, skipping formats: %1")
+                 .arg(skipped.join(", ")), LogWarning );
+            foreach ( const QString &format, skipped )
+                m_fetchFormats.removeOne(format);
+        }
+
+        return false;
+    }
+
+    return true;
+}
+#endif
+
+void ClipboardMonitor::fetchTimeout()
+{
+    if ( m_fetchData.isNull() )
+        return;
+
+#ifdef COPYQ_WS_X11
+    // Wait until data are retrieved in background.
+    if (m_selectionReader != NULL)
+        return;
+#endif
+
+    if ( !m_fetchFormats.isEmpty() ) {
+        const QString format = m_fetchFormats.first();
+
+#ifdef COPYQ_WS_X11
+        // Slow clipboard owner or large data would block monitor so retrieve
+        // all formats in separate thread.
+        startSelectionReader(format);
+        return;
+#else
+        const QMimeData *data = clipboardData(m_fetchMode);
+        if (!data) {
+            log( tr("Cannot access clipboard data!"), LogError );
+            abortFetching();
+            return;
+        }
+
+        fetchFormat(*data, format);
+#endif
+    }
+
+    if ( m_fetchFormats.isEmpty() )
+        finishFetching();
+    else
+        m_fetchTimer->start();
+}
+
+void ClipboardMonitor::finishFetching()
+{
+    if ( !isFetching() )
+        return;
+
+    m_fetchTimer->stop();
+#ifdef COPYQ_WS_X11
+    Q_ASSERT(m_selectionReader == NULL);
+#endif
+
+    const QClipboard::Mode mode = m_fetchMode;
+    QMimeData *data2 = m_fetchData.take();
 
 #ifdef COPYQ_WS_X11
     if (mode == QClipboard::Clipboard) {
@@ -285,34 +569,140 @@ void ClipboardMonitor::checkClipboard(QClipboard::Mode mode)
 #else /* !COPYQ_WS_X11 */
     clipboardChanged(mode, data2);
 #endif
+
+    m_checkLatency.addSample( m_fetchChangeTime.elapsed() );
+    if ( !m_statsTimer->isActive() )
+        m_statsTimer->start();
+
+    // Check content changed while retrieving.
+    if ( !m_updateTimer->isActive() )
+        updateTimeout();
 }
 
-void ClipboardMonitor::clipboardChanged(QClipboard::Mode, QMimeData *data)
+void ClipboardMonitor::abortFetching()
 {
-    ClipboardItem item;
+    m_fetchTimer->stop();
+    m_fetchData.reset();
+    m_fetchFormats.clear();
 
-    item.setData(data);
+#ifdef COPYQ_WS_X11
+    if (m_selectionReader != NULL) {
+        // Don't block monitor; thread finishes shortly after it's aborted.
+        m_selectionReader->abort();
+        connect( m_selectionReader, SIGNAL(finished()),
+                 m_selectionReader, SLOT(deleteLater()) );
+        if ( m_selectionReader->isFinished() )
+            delete m_selectionReader;
+        m_selectionReader = NULL;
+    }
+#endif
+}
+
+#ifdef COPYQ_WS_X11
+void ClipboardMonitor::startSelectionReader(const QString &format)
+{
+    Q_ASSERT(m_selectionReader == NULL);
 
-    // send clipboard item
-    QByteArray msg;
-    QDataStream out(&msg, QIODevice::WriteOnly);
-    out << item;
-    writeMessage(m_socket, msg);
+    m_fetchFormats.removeOne(format);
+
+    m_selectionReader = new X11SelectionReader(
+                m_fetchMode == QClipboard::Selection, format, maxSelectionSize, this);
+    m_selectionReader->setExpectedContent(m_fetchOwner, m_fetchTimestamp);
+    connect( m_selectionReader, SIGNAL(finished()),
+             this, SLOT(selectionReaderFinished()) );
+    m_selectionReader->start();
+}
+
+void ClipboardMonitor::takeSelectionReaderData()
+{
+    Q_ASSERT(m_selectionReader != NULL);
+
+    if ( m_selectionReader->isOutdated() ) {
+        // Clipboard changed in the meantime so drop formats of old content.
+        COPYQ_LOG( QString("Dropping outdated clipboard formats: %1")
+                   .arg(m_selectionReader->errorString()) );
+        m_selectionReader->deleteLater();
+        m_selectionReader = NULL;
+        abortFetching();
+        return;
+    }
+
+    if (m_fetchTimestamp == 0)
+        m_fetchTimestamp = m_selectionReader->timestamp();
+
+    const QString &format = m_selectionReader->format();
+    if ( m_selectionReader->isValid() ) {
+        const QByteArray bytes = m_selectionReader->data();
+        if ( !bytes.isEmpty() )
+            m_fetchData->setData(format, bytes);
+    } else {
+        log( tr("Cannot retrieve clipboard format \"%1\": %2")
+             .arg(format).arg(m_selectionReader->errorString()), LogWarning );
+    }
+
+    m_selectionReader->deleteLater();
+    m_selectionReader = NULL;
+}
+
+void ClipboardMonitor::selectionReaderFinished()
+{
+    if ( m_selectionReader == NULL || sender() != m_selectionReader )
+        return;
+
+    takeSelectionReaderData();
+    fetchTimeout();
+}
+#endif
+
+void ClipboardMonitor::clipboardChanged(QClipboard::Mode, QMimeData *data)
+{
+    // send clipboard data
+    writeMessage( m_socket, serializeData(*data) );
+    delete data;
 }
 
 void ClipboardMonitor::updateTimeout()
 {
+#ifdef COPYQ_WS_X11
+    updateThrottleInterval(m_updateTimer, m_needCheckClipboard || m_needCheckSelection);
+#else
+    updateThrottleInterval(m_updateTimer, m_needCheckClipboard);
+#endif
+
     if (m_needCheckClipboard) {
         checkClipboard(QClipboard::Clipboard);
 #ifdef COPYQ_WS_X11
     } else if (m_needCheckSelection) {
         checkClipboard(QClipboard::Selection);
 #endif
-    } else if (m_newdata) {
-        updateClipboard();
     }
 }
 
+void ClipboardMonitor::setClipboardTimeout()
+{
+    updateThrottleInterval( m_setClipboardTimer, !m_newdata.isNull() );
+    if ( !m_newdata.isNull() )
+        updateClipboard();
+}
+
+void ClipboardMonitor::sendStats()
+{
+    QVariantMap stats;
+    stats["clipboard_check_latency"] = m_checkLatency.toString();
+    stats["clipboard_set_latency"] = m_setLatency.toString();
+    stats["coalesced_changes"] = m_coalescedChanges;
+    stats["check_interval_ms"] = m_updateTimer->interval();
+    stats["set_interval_ms"] = m_setClipboardTimer->interval();
+
+    QByteArray statsData;
+    QDataStream statsOut(&statsData, QIODevice::WriteOnly);
+    statsOut << stats;
+
+    QMimeData data;
+    data.setData(mimeMonitorStats, statsData);
+    writeMessage( m_socket, serializeData(data) );
+}
+
 void ClipboardMonitor::readyRead()
 {
     m_socket->blockSignals(true);
@@ -324,12 +714,22 @@ void ClipboardMonitor::readyRead()
             return;
         }
 
-        ClipboardItem item;
-        QDataStream in(&msg, QIODevice::ReadOnly);
-        in >> item;
+        QScopedPointer<QMimeData> data(new QMimeData);
+        if ( !deserializeData(data.data(), msg) ) {
+            log( tr("Cannot read message from server!"), LogError );
+            return;
+        }
+
+        /* Reply to heartbeat from server immediately. */
+        if ( data->hasFormat(mimeMonitorPing) ) {
+            QMimeData pong;
+            pong.setData( mimeMonitorPong, data->data(mimeMonitorPing) );
+            writeMessage( m_socket, serializeData(pong) );
+            continue;
+        }
 
         /* Does server send settings for monitor? */
-        QByteArray settings_data = item.data()->data("application/x-copyq-settings");
+        QByteArray settings_data = data->data("application/x-copyq-settings");
         if ( !settings_data.isEmpty() ) {
 
             QDataStream settings_in(settings_data);
@@ -369,7 +769,7 @@ void ClipboardMonitor::readyRead()
 
             COPYQ_LOG("Configured");
         } else {
-            updateClipboard( cloneData(*item.data()) );
+            updateClipboard( data.take() );
         }
     }
 
@@ -378,14 +778,24 @@ void ClipboardMonitor::readyRead()
 
 void ClipboardMonitor::updateClipboard(QMimeData *data)
 {
-    if (data != NULL)
+    if (data != NULL) {
         m_newdata.reset(data);
-    if ( m_updateTimer->isActive() )
+        if ( !m_newDataTime.isValid() )
+            m_newDataTime.start();
+    }
+
+    // Only the newest data are set if clipboard is changed very quickly.
+    if ( m_setClipboardTimer->isActive() || !m_newdata )
         return;
 
+    // New content has priority; content being retrieved would be replaced anyway.
+    if ( isFetching() )
+        abortFetching();
+
     COPYQ_LOG("Updating clipboard");
 
 #ifdef COPYQ_WS_X11
+    // Clipboard and selection share the payload (cloneData() doesn't copy bytes).
     setClipboardData(cloneData(*m_newdata), QClipboard::Selection);
     m_needCheckSelection = false;
 #endif
@@ -394,6 +804,11 @@ void ClipboardMonitor::updateClipboard(QMimeData *data)
 
     m_newdata.reset();
 
-    m_updateTimer->start();
+    m_setLatency.addSample( m_newDataTime.elapsed() );
+    m_newDataTime.invalidate();
+    if ( !m_statsTimer->isActive() )
+        m_statsTimer->start();
+
+    m_setClipboardTimer->start();
 }
 
@@ -23,8 +23,10 @@
 #include "app.h"
 
 #include "common/client_server.h"
+#include "common/latencyhistogram.h"
 
 #include <QClipboard>
+#include <QElapsedTimer>
 #include <QLocalSocket>
 #include <QScopedPointer>
 #include <QStringList>
@@ -33,6 +35,7 @@ class QMimeData;
 class QTimer;
 #ifdef COPYQ_WS_X11
 class PrivateX11;
+class X11SelectionReader;
 #endif
 
 /**
@@ -74,12 +77,49 @@ private:
 #endif
     QLocalSocket *m_socket;
 
-    // don't allow rapid access to clipboard
+    /**
+     * Coalesces clipboard checks while clipboard changes rapidly.
+     *
+     * First change is checked immediately; interval grows while changes
+     * keep coming (see updateTimeout()).
+     */
     QTimer *m_updateTimer;
     bool m_needCheckClipboard;
+    QElapsedTimer m_clipboardChangeTime;
+
+    /** Limits rate of setting clipboard content (see updateClipboard()). */
+    QTimer *m_setClipboardTimer;
+    QElapsedTimer m_newDataTime;
+
+    /** Latency from clipboard change until data are sent to server. */
+    LatencyHistogram m_checkLatency;
+    /** Latency from receiving data from server until clipboard is set. */
+    LatencyHistogram m_setLatency;
+    int m_coalescedChanges;
+    QTimer *m_statsTimer;
+
+    /** Clipboard content being retrieved (NULL if no content is retrieved). */
+    QScopedPointer<QMimeData> m_fetchData;
+    QClipboard::Mode m_fetchMode;
+    /** Formats to retrieve later. */
+    QStringList m_fetchFormats;
+    QElapsedTimer m_fetchChangeTime;
+    QTimer *m_fetchTimer;
 
 #ifdef COPYQ_WS_X11
     bool m_needCheckSelection;
+    QElapsedTimer m_selectionChangeTime;
+
+    /** Retrieves data in background (NULL if not running). */
+    X11SelectionReader *m_selectionReader;
+
+    /**
+     * Owner and timestamp (zero if not known yet) of content being retrieved.
+     *
+     * Formats retrieved later are dropped if they don't match.
+     */
+    unsigned long m_fetchOwner;
+    unsigned long m_fetchTimestamp;
 
     // stuff for X11 window system
     PrivateX11* m_x11;
@@ -88,6 +128,40 @@ private:
     /** Send new clipboard or primary selection data to server. */
     void clipboardChanged(QClipboard::Mode mode, QMimeData *data);
 
+#ifndef COPYQ_WS_X11
+    /**
+     * Retrieve @a format from @a data.
+     *
+     * Returns false if it took too long (other expensive formats are skipped).
+     */
+    bool fetchFormat(const QMimeData &data, const QString &format);
+#endif
+
+    /** Return true if clipboard content is being retrieved. */
+    bool isFetching() const { return !m_fetchData.isNull(); }
+
+    /**
+     * Send retrieved content to server.
+     *
+     * Also checks clipboard changes postponed while retrieving.
+     */
+    void finishFetching();
+
+    /** Stop retrieving outdated clipboard content. */
+    void abortFetching();
+
+#ifdef COPYQ_WS_X11
+    /** Start retrieving @a format of current content in background. */
+    void startSelectionReader(const QString &format);
+
+    /**
+     * Store data retrieved in background (call after retrieval finished).
+     *
+     * Stops retrieving if clipboard content changed in the meantime.
+     */
+    void takeSelectionReaderData();
+#endif
+
 public slots:
     /**
      * Check clipboard or primary selection.
@@ -108,15 +182,32 @@ private slots:
             //!< Call checkClipboard(QClipboard::Selection) afterwards.
             );
 
+    /**
+     * Check selection again if mouse button or key was released.
+     */
+    void onX11InputEvent();
+
     /**
      * Synchronize clipboard and X11 primary selection.
      */
     void synchronize();
+
+    /** Store data retrieved in background and continue with other formats. */
+    void selectionReaderFinished();
 #endif
 
-    /** Update clipboard data in reasonably long intervals. */
+    /** Check clipboard again if it changed in the meantime. */
     void updateTimeout();
 
+    /** Set postponed clipboard data. */
+    void setClipboardTimeout();
+
+    /** Send latency statistics to server. */
+    void sendStats();
+
+    /** Retrieve next format of current clipboard content. */
+    void fetchTimeout();
+
     /** Data can be received from monitor. */
     void readyRead();
 };
@@ -19,6 +19,9 @@
 
 #include "clipboardserver.h"
 
+#include "app/argumentreceiver.h"
+#include "app/batchsession.h"
+#include "app/clipboardingest.h"
 #include "app/remoteprocess.h"
 #include "common/arguments.h"
 #include "gui/clipboardbrowser.h"
@@ -27,6 +30,7 @@
 #include "item/clipboarditem.h"
 #include "item/itemfactory.h"
 #include "scriptable/scriptableworker.h"
+#include "scriptable/scriptenginepool.h"
 
 #include <QAction>
 #include <QApplication>
@@ -34,7 +38,8 @@
 #include <QLocalServer>
 #include <QLocalSocket>
 #include <QMenu>
-#include <QThread>
+#include <QMimeData>
+#include <QTimer>
 
 #ifdef NO_GLOBAL_SHORTCUTS
 struct QxtGlobalShortcut {};
@@ -42,6 +47,23 @@ struct QxtGlobalShortcut {};
 #include "../qxt/qxtglobalshortcut.h"
 #endif
 
+namespace {
+
+/// Interval for checking if monitor is responding.
+const int heartbeatIntervalMs = 2000;
+
+/// Monitor is restarted if it doesn't reply to heartbeat in given time.
+const int heartbeatTimeoutMs = 10000;
+
+/// Delay before restarting monitor (doubled after each restart).
+const int minRestartDelayMs = 500;
+const int maxRestartDelayMs = 30000;
+
+/// Idle threads running commands (each with initialized scripting engine) are kept for given time.
+const int commandThreadExpiryMs = 10 * 60 * 1000;
+
+} // namespace
+
 ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionName)
     : QObject()
     , App(new QApplication(argc, argv), sessionName)
@@ -52,7 +74,23 @@ ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionN
     , m_lastHash(0)
     , m_shortcutActions()
     , m_clientThreads()
+    , m_internalThreads()
+    , m_heartbeatTimer( new QTimer(this) )
+    , m_heartbeatTime()
+    , m_heartbeatId(0)
+    , m_heartbeatLatency()
+    , m_restartTimer( new QTimer(this) )
+    , m_restartDelayMs(minRestartDelayMs)
+    , m_monitorRestarts(0)
+    , m_monitorUptime()
+    , m_eventsSeen(0)
+    , m_eventsDropped(0)
+    , m_eventsDeduplicated(0)
+    , m_ingestLatency()
+    , m_ingest( new ClipboardIngest(this) )
 {
+    m_heartbeatTime.invalidate();
+    m_monitorUptime.invalidate();
     // listen
     m_server = newServer( clipboardServerName(), this );
     if ( !m_server->isListening() )
@@ -74,6 +112,9 @@ ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionN
     connect( m_wnd, SIGNAL(changeClipboard(const ClipboardItem*)),
              this, SLOT(changeClipboard(const ClipboardItem*)));
 
+    connect( m_ingest, SIGNAL(ingested(IngestedData)),
+             this, SLOT(monitorMessageIngested(IngestedData)) );
+
     loadSettings();
 
     // notify window if configuration changes
@@ -88,8 +129,21 @@ ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionN
         m_lastHash = 0;
 
     // run clipboard monitor
+    m_heartbeatTimer->setInterval(heartbeatIntervalMs);
+    connect( m_heartbeatTimer, SIGNAL(timeout()),
+             this, SLOT(monitorHeartbeat()) );
+
+    m_restartTimer->setSingleShot(true);
+    connect( m_restartTimer, SIGNAL(timeout()),
+             this, SLOT(startMonitoring()) );
+
     startMonitoring();
 
+    // Prepare scripting engine for first command.
+    m_clientThreads.setExpiryTimeout(commandThreadExpiryMs);
+    m_internalThreads.setExpiryTimeout(commandThreadExpiryMs);
+    ScriptEnginePool::instance()->warmUp(&m_clientThreads, m_wnd);
+
     QCoreApplication::instance()->installEventFilter(this);
 }
 
@@ -97,9 +151,9 @@ ClipboardServer::~ClipboardServer()
 {
     emit terminateClientThreads();
     m_clientThreads.waitForDone();
+    m_internalThreads.waitForDone();
 
-    if( isMonitoring() )
-        stopMonitoring();
+    stopMonitoring();
 
     delete m_wnd;
 
@@ -125,9 +179,7 @@ void ClipboardServer::monitorStateChanged(QProcess::ProcessState newState)
         log(msg, LogError);
         m_wnd->showError(msg);
 
-        // restart clipboard monitor
-        stopMonitoring();
-        startMonitoring();
+        restartMonitoring();
     } else if (newState == QProcess::Starting) {
         log( tr("Clipboard Monitor: Starting") );
     } else if (newState == QProcess::Running) {
@@ -151,6 +203,10 @@ void ClipboardServer::monitorStandardError()
 
 void ClipboardServer::stopMonitoring()
 {
+    // Pending restart must be canceled even if monitor is not running.
+    m_heartbeatTimer->stop();
+    m_restartTimer->stop();
+
     if (m_monitor == NULL)
         return;
 
@@ -159,8 +215,8 @@ void ClipboardServer::stopMonitoring()
 
     log( tr("Clipboard Monitor: Terminating") );
 
-    m_monitor->disconnect();
-    m_monitor->process().disconnect();
+    m_monitor->disconnect(this);
+    m_monitor->process().disconnect(this);
     m_monitor->closeConnection();
     m_monitor->deleteLater();
     m_monitor = NULL;
@@ -182,22 +238,39 @@ void ClipboardServer::startMonitoring()
                  this, SLOT(newMonitorMessage(QByteArray)) );
         connect( m_monitor, SIGNAL(connectionError()),
                  this, SLOT(monitorConnectionError()) );
+        connect( m_monitor, SIGNAL(connected()),
+                 this, SLOT(monitorConnected()) );
 
         const QString name = clipboardMonitorServerName();
         m_monitor->start( name, QStringList("monitor") << name );
-        if ( !m_monitor->isConnected() ) {
-            log( tr("Cannot start clipboard monitor!"), LogError );
-            delete m_monitor;
-            m_monitor = NULL;
-            exit(10);
-            return;
-        }
-
-        loadMonitorSettings();
     }
     m_wnd->browser(0)->setAutoUpdate(true);
 }
 
+void ClipboardServer::restartMonitoring()
+{
+    if (m_monitor != NULL) {
+        m_monitor->disconnect(this);
+        m_monitor->process().disconnect(this);
+        m_monitor->closeConnectionLater();
+        m_monitor = NULL;
+    }
+
+    m_heartbeatTimer->stop();
+    m_heartbeatTime.invalidate();
+    m_monitorUptime.invalidate();
+
+    if ( m_restartTimer->isActive() )
+        return;
+
+    ++m_monitorRestarts;
+    updateStats();
+
+    log( tr("Clipboard Monitor: Restarting in %1 ms").arg(m_restartDelayMs) );
+    m_restartTimer->start(m_restartDelayMs);
+    m_restartDelayMs = qMin(2 * m_restartDelayMs, maxRestartDelayMs);
+}
+
 void ClipboardServer::loadMonitorSettings()
 {
     if ( !isMonitoring() ) {
@@ -209,8 +282,15 @@ void ClipboardServer::loadMonitorSettings()
 
     ConfigurationManager *cm = ConfigurationManager::instance();
 
+    // Monitor retrieves only formats needed by plugins and automatic commands.
+    QStringList formats = ItemFactory::instance()->formatsToSave();
+    foreach ( const Command &c, cm->commands() ) {
+        if ( c.automatic && !c.input.isEmpty() && !formats.contains(c.input) )
+            formats.append(c.input);
+    }
+
     QVariantMap settings;
-    settings["formats"] = ItemFactory::instance()->formatsToSave();
+    settings["formats"] = formats;
     m_checkclip = cm->value("check_clipboard").toBool();
 #ifdef COPYQ_WS_X11
     settings["copy_clipboard"] = cm->value("copy_clipboard");
@@ -222,13 +302,9 @@ void ClipboardServer::loadMonitorSettings()
     QDataStream settings_out(&settings_data, QIODevice::WriteOnly);
     settings_out << settings;
 
-    ClipboardItem item;
-    item.setData("application/x-copyq-settings", settings_data);
-
-    QByteArray msg;
-    QDataStream out(&msg, QIODevice::WriteOnly);
-    out << item;
-    m_monitor->writeMessage(msg);
+    QMimeData data;
+    data.setData("application/x-copyq-settings", settings_data);
+    m_monitor->writeMessage( serializeData(data) );
 }
 
 bool ClipboardServer::isMonitoring()
@@ -253,10 +329,29 @@ void ClipboardServer::newConnection()
         QDataStream in(msg);
         in >> args;
 
+        // Optional index of argument streamed in following messages.
+        int streamedArgument = -1;
+        if ( !in.atEnd() )
+            in >> streamedArgument;
+
         COPYQ_LOG( QString("%1: Message received from client.").arg(id) );
 
-        // try to handle command
-        doCommand(args, client);
+        if ( streamedArgument > Arguments::CurrentPath && streamedArgument < args.length() ) {
+            ArgumentReceiver *receiver = new ArgumentReceiver(client, args, streamedArgument);
+            connect( receiver, SIGNAL(received(Arguments,QLocalSocket*)),
+                     this, SLOT(doStreamedCommand(Arguments,QLocalSocket*)) );
+            // Client may have already sent some data.
+            receiver->readChunks();
+        } else if ( BatchSession::isBatchCommand(args) ) {
+            BatchSession *session = new BatchSession(client);
+            connect( session, SIGNAL(commandRequested(BatchSession*,Arguments,int)),
+                     this, SLOT(doBatchCommand(BatchSession*,Arguments,int)) );
+            // Client may have already sent some commands.
+            session->readRequests();
+        } else {
+            // try to handle command
+            doCommand(args, client);
+        }
     } else {
         const QString error = client->errorString();
         log( tr("Cannot read message from client! (%1)").arg(error), LogError );
@@ -264,7 +359,18 @@ void ClipboardServer::newConnection()
     }
 }
 
-void ClipboardServer::sendMessage(QLocalSocket* client, const QByteArray &message, int exitCode)
+void ClipboardServer::doBatchCommand(BatchSession *session, const Arguments &args, int requestId)
+{
+    doCommand(args, session->client(), session, requestId);
+}
+
+void ClipboardServer::doStreamedCommand(const Arguments &args, QLocalSocket *client)
+{
+    doCommand(args, client);
+}
+
+void ClipboardServer::sendMessage(QLocalSocket* client, const QByteArray &message, int exitCode,
+                                  int requestId)
 {
 #ifdef COPYQ_LOG_DEBUG
     quintptr id = client->socketDescriptor();
@@ -278,11 +384,13 @@ void ClipboardServer::sendMessage(QLocalSocket* client, const QByteArray &messag
         QByteArray msg;
         QDataStream out(&msg, QIODevice::WriteOnly);
         out << exitCode;
+        if (requestId >= 0)
+            out << requestId;
         out.writeRawData( message.constData(), message.length() );
         writeMessage(client, msg);
         if (exitCode == CommandFinished) {
             connect(client, SIGNAL(disconnected()),
-                    client, SLOT(deleteLater()));
+                    client, SLOT(deleteLater()), Qt::UniqueConnection);
             COPYQ_LOG( QString("%1: Disconnected from client.").arg(id) );
         } else if (exitCode == CommandExit) {
             client->flush();
@@ -298,24 +406,124 @@ void ClipboardServer::newMonitorMessage(const QByteArray &message)
 {
     COPYQ_LOG("Receiving message from monitor.");
 
+    if ( ClipboardIngest::isControlMessage(message) ) {
+        QMimeData data;
+        if ( deserializeData(&data, message) )
+            monitorControlMessage(data);
+        return;
+    }
+
+    m_ingest->addMessage(message);
+}
+
+void ClipboardServer::monitorControlMessage(const QMimeData &data)
+{
+    if ( data.hasFormat(mimeMonitorPong) ) {
+        monitorHeartbeatReply( data.data(mimeMonitorPong) );
+        return;
+    }
+
+    const QByteArray statsData = data.data(mimeMonitorStats);
+    if ( !statsData.isEmpty() ) {
+        QDataStream statsIn(statsData);
+        QVariantMap stats;
+        statsIn >> stats;
+        m_wnd->setStats("monitor", stats);
+    }
+}
+
+void ClipboardServer::monitorMessageIngested(const IngestedData &ingested)
+{
+    if (ingested.data == NULL) {
+        log( tr("Cannot read message from monitor!"), LogError );
+        ++m_eventsDropped;
+        updateStats();
+        return;
+    }
+
     ClipboardItem item;
-    QDataStream in(message);
-    in >> item;
+    item.setData( ingested.data, ingested.dataHash );
+
+    ++m_eventsSeen;
 
     m_wnd->clipboardChanged(&item);
 
-    if ( m_checkclip && !item.isEmpty() && m_lastHash != item.dataHash() ) {
+    if ( !m_checkclip || item.isEmpty() ) {
+        ++m_eventsDropped;
+    } else if ( m_lastHash == item.dataHash() ) {
+        ++m_eventsDeduplicated;
+    } else {
         m_lastHash = item.dataHash();
-        m_wnd->addToTab( item.data(), QString(), true );
+        const uint dataHash = item.dataHash();
+        m_wnd->addClipboardData( item.takeData(), dataHash, ingested.text, ingested.commands );
+        m_ingestLatency.addSample( ingested.receiveTime.elapsed() );
     }
 
+    updateStats();
+
     COPYQ_LOG("Message received from monitor.");
 }
 
 void ClipboardServer::monitorConnectionError()
 {
-    stopMonitoring();
-    startMonitoring();
+    log( tr("Cannot connect to clipboard monitor!"), LogError );
+    restartMonitoring();
+}
+
+void ClipboardServer::monitorConnected()
+{
+    m_monitorUptime.start();
+    m_heartbeatTime.invalidate();
+    m_heartbeatTimer->start();
+    loadMonitorSettings();
+}
+
+void ClipboardServer::monitorHeartbeat()
+{
+    if ( !isMonitoring() )
+        return;
+
+    if ( m_heartbeatTime.isValid() ) {
+        if ( m_heartbeatTime.elapsed() > heartbeatTimeoutMs ) {
+            log( tr("Clipboard monitor is not responding!"), LogError );
+            restartMonitoring();
+        }
+        return;
+    }
+
+    ++m_heartbeatId;
+    QMimeData data;
+    data.setData( mimeMonitorPing, QByteArray::number(m_heartbeatId) );
+    m_monitor->writeMessage( serializeData(data) );
+    m_heartbeatTime.start();
+}
+
+void ClipboardServer::monitorHeartbeatReply(const QByteArray &id)
+{
+    if ( !m_heartbeatTime.isValid() || id.toUInt() != m_heartbeatId )
+        return;
+
+    m_heartbeatLatency.addSample( m_heartbeatTime.elapsed() );
+    m_heartbeatTime.invalidate();
+
+    // Monitor seems stable so next restart can be fast.
+    if ( m_monitorUptime.isValid() && m_monitorUptime.elapsed() > heartbeatTimeoutMs )
+        m_restartDelayMs = minRestartDelayMs;
+
+    updateStats();
+}
+
+void ClipboardServer::updateStats()
+{
+    QVariantMap stats;
+    stats["monitor_events_seen"] = m_eventsSeen;
+    stats["monitor_events_dropped"] = m_eventsDropped;
+    stats["monitor_events_deduplicated"] = m_eventsDeduplicated;
+    stats["monitor_restarts"] = m_monitorRestarts;
+    stats["monitor_heartbeat_rtt"] = m_heartbeatLatency.toString();
+    stats["ingest_latency"] = m_ingestLatency.toString();
+    m_wnd->setStats("server", stats);
+    m_wnd->setStats("commands", m_ingest->commandStats());
 }
 
 void ClipboardServer::changeClipboard(const ClipboardItem *item)
@@ -327,22 +535,23 @@ void ClipboardServer::changeClipboard(const ClipboardItem *item)
 
     COPYQ_LOG("Sending message to monitor.");
 
-    QByteArray msg;
-    QDataStream out(&msg, QIODevice::WriteOnly);
-    out << *item;
-    m_monitor->writeMessage(msg);
+    m_monitor->writeMessage( serializeData(*item->data()) );
     m_lastHash = item->dataHash();
 }
 
-void ClipboardServer::doCommand(const Arguments &args, QLocalSocket *client)
+void ClipboardServer::doCommand(const Arguments &args, QLocalSocket *client,
+                                BatchSession *session, int requestId)
 {
     // Worker object without parent needs to be deleted afterwards!
     // There is no parent so as it's possible to move the worker to another thread.
-    ScriptableWorker *worker = new ScriptableWorker(m_wnd, args, client);
+    ScriptableWorker *worker = new ScriptableWorker(m_wnd, args, client, requestId);
 
     // Delete worker after it's finished.
     connect(worker, SIGNAL(finished()), worker, SLOT(deleteLater()));
 
+    if (session != NULL)
+        connect(worker, SIGNAL(finished()), session, SLOT(commandFinished()));
+
     // Terminate worket at application exit.
     connect(this, SIGNAL(terminateClientThreads()),
             worker, SLOT(terminate()));
@@ -350,22 +559,15 @@ void ClipboardServer::doCommand(const Arguments &args, QLocalSocket *client)
     if (client != NULL) {
         connect(client, SIGNAL(disconnected()),
                 worker, SLOT(terminate()));
-        connect(worker, SIGNAL(sendMessage(QLocalSocket*,QByteArray,int)),
-                this, SLOT(sendMessage(QLocalSocket*,QByteArray,int)));
+        connect(worker, SIGNAL(sendMessage(QLocalSocket*,QByteArray,int,int)),
+                this, SLOT(sendMessage(QLocalSocket*,QByteArray,int,int)));
 
         // Add client thread to pool.
         m_clientThreads.start(worker);
     } else {
-        // Run internally created command immediatelly (should be fast).
-        QThread *workerThread = new QThread(this);
-        worker->moveToThread(workerThread);
-
-        // t.started -> w.run -> w.finished -> t.quit -> t.finished -> delete t,w,c
-        connect(workerThread, SIGNAL(started()), worker, SLOT(run()));
-        connect(worker, SIGNAL(finished()), workerThread, SLOT(quit()));
-        connect(workerThread, SIGNAL(finished()), workerThread, SLOT(deleteLater()));
-
-        workerThread->start();
+        // Run internally created command in separate pool so it doesn't wait
+        // for client commands (should be fast).
+        m_internalThreads.start(worker);
     }
 }
 
@@ -509,6 +711,8 @@ void ClipboardServer::loadSettings()
     }
 #endif
 
+    m_ingest->setCommands( ConfigurationManager::instance()->commands() );
+
     // reload clipboard monitor configuration
     if ( isMonitoring() )
         loadMonitorSettings();
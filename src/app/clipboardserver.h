@@ -22,19 +22,25 @@
 
 #include "app.h"
 #include "common/client_server.h"
+#include "common/latencyhistogram.h"
 
+#include <QElapsedTimer>
 #include <QMap>
 #include <QProcess>
 #include <QThreadPool>
 
 class Arguments;
+class BatchSession;
 class ClipboardBrowser;
+class ClipboardIngest;
 class ClipboardItem;
 class MainWindow;
 class RemoteProcess;
 class QLocalServer;
 class QLocalSocket;
+class QTimer;
 class QxtGlobalShortcut;
+struct IngestedData;
 
 /**
  * The application main server.
@@ -59,14 +65,20 @@ public:
      */
     void doCommand(
             const Arguments &args, //!< Contains command and its arguments.
-            QLocalSocket *client = NULL //!< For sending responses.
+            QLocalSocket *client = NULL, //!< For sending responses.
+            BatchSession *session = NULL, //!< Notified when command finishes.
+            int requestId = -1 //!< Request ID in batch session.
             );
 
     /** Stop monitor application. */
     void stopMonitoring();
 
-    /** Start monitor application. */
-    void startMonitoring();
+    /**
+     * Stop monitor application without waiting and start it again later.
+     *
+     * Delay before restarting grows with each consecutive restart.
+     */
+    void restartMonitoring();
 
     /** Send configuration to monitor. */
     void loadMonitorSettings();
@@ -102,8 +114,45 @@ private:
     uint m_lastHash;
     QMap<QxtGlobalShortcut*, Arguments> m_shortcutActions;
     QThreadPool m_clientThreads;
+    QThreadPool m_internalThreads;
+
+    /** Sends heartbeat to monitor and restarts monitor if it doesn't reply. */
+    QTimer *m_heartbeatTimer;
+    /** Time since last unanswered heartbeat was sent (invalid if answered). */
+    QElapsedTimer m_heartbeatTime;
+    uint m_heartbeatId;
+    LatencyHistogram m_heartbeatLatency;
+
+    QTimer *m_restartTimer;
+    int m_restartDelayMs;
+    int m_monitorRestarts;
+    QElapsedTimer m_monitorUptime;
+
+    /** Clipboard changes received from monitor. */
+    int m_eventsSeen;
+    /** Clipboard changes not stored because storing is disabled or data are empty. */
+    int m_eventsDropped;
+    /** Clipboard changes not stored because content is same as last time. */
+    int m_eventsDeduplicated;
+    /** Time from receiving clipboard change until it's stored in history. */
+    LatencyHistogram m_ingestLatency;
+
+    /** Prepares new clipboard data in background. */
+    ClipboardIngest *m_ingest;
+
+    /** Handle heartbeat reply from monitor. */
+    void monitorHeartbeatReply(const QByteArray &id);
+
+    /** Handle heartbeat reply or statistics from monitor. */
+    void monitorControlMessage(const QMimeData &data);
+
+    /** Pass server statistics to main window. */
+    void updateStats();
 
 public slots:
+    /** Start monitor application (doesn't wait for monitor to connect). */
+    void startMonitoring();
+
     /** Load @a item data to clipboard. */
     void changeClipboard(const ClipboardItem *item);
 
@@ -117,9 +166,18 @@ private slots:
     /** New message from monitor process. */
     void newMonitorMessage(const QByteArray &message);
 
+    /** Message from monitor was processed in background. */
+    void monitorMessageIngested(const IngestedData &ingested);
+
     /** An error occurred on monitor connection. */
     void monitorConnectionError();
 
+    /** Monitor process connected to server. */
+    void monitorConnected();
+
+    /** Check if monitor is responding. */
+    void monitorHeartbeat();
+
     /** Monitor state changed. */
     void monitorStateChanged(QProcess::ProcessState newState);
 
@@ -129,11 +187,18 @@ private slots:
     /** Shortcut was pressed on host system. */
     void shortcutActivated(QxtGlobalShortcut *shortcut);
 
+    /** Start command after its argument was streamed from client. */
+    void doStreamedCommand(const Arguments &args, QLocalSocket *client);
+
+    /** Start command from batch session. */
+    void doBatchCommand(BatchSession *session, const Arguments &args, int requestId);
+
     /** Send message to client. */
     void sendMessage(
             QLocalSocket* client, //!< Client socket.
             const QByteArray &message, //!< Message for client.
-            int exitCode = 0 //!< Exit code for client (non-zero for an error).
+            int exitCode = 0, //!< Exit code for client (non-zero for an error).
+            int requestId = -1 //!< Request ID in batch session (omitted if negative).
             );
 };
 
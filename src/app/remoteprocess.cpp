@@ -26,13 +26,28 @@
 #include <QLocalServer>
 #include <QLocalSocket>
 #include <QString>
+#include <QTimer>
+
+namespace {
+
+/// Time to wait for process to connect or to exit after connection is closed.
+const int processTimeoutMs = 2000;
+
+} // namespace
 
 RemoteProcess::RemoteProcess(QObject *parent)
     : QObject(parent)
     , m_process()
     , m_server(NULL)
     , m_socket(NULL)
+    , m_connectionTimer( new QTimer(this) )
 {
+    m_connectionTimer->setSingleShot(true);
+    m_connectionTimer->setInterval(processTimeoutMs);
+    connect( m_connectionTimer, SIGNAL(timeout()),
+             this, SLOT(onConnectionTimeout()) );
+    connect( &m_process, SIGNAL(error(QProcess::ProcessError)),
+             this, SLOT(onProcessError(QProcess::ProcessError)) );
 }
 
 RemoteProcess::~RemoteProcess()
@@ -49,21 +64,23 @@ void RemoteProcess::start(const QString &newServerName, const QStringList &argum
         return;
 
     m_server = newServer(newServerName, &m_process);
+    connect( m_server, SIGNAL(newConnection()),
+             this, SLOT(onNewConnection()) );
 
     COPYQ_LOG( QString("Remote process: Starting new remote process \"%1 %2\".")
                .arg(QCoreApplication::applicationFilePath())
                .arg(arguments.join(" ")) );
 
     m_process.start( QCoreApplication::applicationFilePath(), arguments );
+    m_connectionTimer->start();
+}
 
-    if ( m_process.waitForStarted(2000) && m_server->waitForNewConnection(2000) ) {
-        COPYQ_LOG("Remote process: Started.");
-        m_socket = m_server->nextPendingConnection();
-        connect( m_socket, SIGNAL(readyRead()),
-                 this, SLOT(readyRead()) );
-    } else {
-        log( "Remote process: Failed to start new remote process!", LogError );
-    }
+bool RemoteProcess::waitForConnected(int msecs)
+{
+    if ( m_socket == NULL && m_server != NULL && m_process.waitForStarted(msecs) )
+        m_server->waitForNewConnection(msecs);
+
+    return isConnected();
 }
 
 bool RemoteProcess::writeMessage(const QByteArray &msg)
@@ -90,15 +107,7 @@ bool RemoteProcess::isConnected() const
 void RemoteProcess::closeConnection()
 {
     if (m_server != NULL) {
-        if (m_socket != NULL) {
-            m_socket->disconnectFromServer();
-            m_socket->deleteLater();
-            m_socket = NULL;
-        }
-
-        m_server->close();
-        m_server->deleteLater();
-        m_server = NULL;
+        closeServer();
 
         if ( m_process.state() != QProcess::NotRunning && !m_process.waitForFinished(1000) ) {
             log( "Remote process: Close connection unsucessful!", LogError );
@@ -114,6 +123,20 @@ void RemoteProcess::closeConnection()
     }
 }
 
+void RemoteProcess::closeConnectionLater()
+{
+    closeServer();
+
+    if ( m_process.state() == QProcess::NotRunning ) {
+        deleteLater();
+        return;
+    }
+
+    connect( &m_process, SIGNAL(finished(int,QProcess::ExitStatus)),
+             this, SLOT(deleteLater()) );
+    QTimer::singleShot( processTimeoutMs / 2, this, SLOT(terminateProcess()) );
+}
+
 void RemoteProcess::readyRead()
 {
     Q_ASSERT(m_server != NULL);
@@ -134,3 +157,68 @@ void RemoteProcess::readyRead()
 
     m_socket->blockSignals(false);
 }
+
+void RemoteProcess::onNewConnection()
+{
+    if (m_server == NULL || m_socket != NULL)
+        return;
+
+    m_connectionTimer->stop();
+
+    COPYQ_LOG("Remote process: Started.");
+    m_socket = m_server->nextPendingConnection();
+    connect( m_socket, SIGNAL(readyRead()),
+             this, SLOT(readyRead()) );
+
+    emit connected();
+}
+
+void RemoteProcess::onConnectionTimeout()
+{
+    if ( m_socket == NULL ) {
+        log( "Remote process: Failed to start new remote process!", LogError );
+        emit connectionError();
+    }
+}
+
+void RemoteProcess::onProcessError(QProcess::ProcessError error)
+{
+    if ( error == QProcess::FailedToStart && m_connectionTimer->isActive() ) {
+        m_connectionTimer->stop();
+        onConnectionTimeout();
+    }
+}
+
+void RemoteProcess::terminateProcess()
+{
+    if ( m_process.state() != QProcess::NotRunning ) {
+        log( "Remote process: Close connection unsucessful!", LogError );
+        m_process.terminate();
+        QTimer::singleShot( processTimeoutMs / 2, this, SLOT(killProcess()) );
+    }
+}
+
+void RemoteProcess::killProcess()
+{
+    if ( m_process.state() != QProcess::NotRunning ) {
+        log( "Remote process: Cannot terminate process!", LogError );
+        m_process.kill();
+    }
+}
+
+void RemoteProcess::closeServer()
+{
+    m_connectionTimer->stop();
+
+    if (m_server != NULL) {
+        if (m_socket != NULL) {
+            m_socket->disconnectFromServer();
+            m_socket->deleteLater();
+            m_socket = NULL;
+        }
+
+        m_server->close();
+        m_server->deleteLater();
+        m_server = NULL;
+    }
+}
@@ -27,6 +27,7 @@ class QByteArray;
 class QLocalServer;
 class QLocalSocket;
 class QString;
+class QTimer;
 
 /**
  * Starts process and handles communication with it.
@@ -41,9 +42,18 @@ public:
 
     /**
      * Starts server and executes current binary (argv[0]) with given @a arguments.
+     *
+     * Doesn't wait for process to connect; connected() or connectionError() is
+     * emitted later.
      */
     void start(const QString &newServerName, const QStringList &arguments);
 
+    /**
+     * Wait at most @a msecs for process to connect.
+     * @return true only if process is connected.
+     */
+    bool waitForConnected(int msecs = 2000);
+
     /**
      * Send message to remote process.
      */
@@ -54,11 +64,25 @@ public:
      */
     bool isConnected() const;
 
+    /** Close connection and wait for process to finish. */
     void closeConnection();
 
+    /**
+     * Close connection without waiting for process to finish.
+     *
+     * Process is terminated or killed if it doesn't exit in time. The object is
+     * deleted after process finishes.
+     */
+    void closeConnectionLater();
+
     QProcess &process() { return m_process; }
 
 signals:
+    /**
+     * Remote process connected.
+     */
+    void connected();
+
     /**
      * Remote processed sends @a message.
      */
@@ -71,11 +95,19 @@ signals:
 
 private slots:
     void readyRead();
+    void onNewConnection();
+    void onConnectionTimeout();
+    void onProcessError(QProcess::ProcessError error);
+    void terminateProcess();
+    void killProcess();
 
 private:
     QProcess m_process;
     QLocalServer *m_server;
     QLocalSocket *m_socket;
+    QTimer *m_connectionTimer;
+
+    void closeServer();
 };
 
 #endif // REMOTEPROCESS_H
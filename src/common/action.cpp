@@ -19,6 +19,117 @@
 
 #include "action.h"
 
+#include "common/client_server.h"
+
+#include <QTextCodec>
+#include <QTextDecoder>
+
+#include <cstring>
+
+namespace {
+
+/** Input is passed to the first process in chunks of this size. */
+const int inputChunkSize = 64 * 1024;
+
+/**
+ * Maximum length of text matched by regular expression separator.
+ *
+ * Only this many characters of text already searched are searched again when
+ * more output arrives (longer separator can be missed if it's split between
+ * chunks of output).
+ */
+const int maxRegExpSeparatorLength = 1024;
+
+/**
+ * Return separator encoded in local 8-bit encoding if it doesn't contain any
+ * special regular expression characters (simple escape sequences are expanded)
+ * and all characters are ASCII, otherwise return empty array.
+ */
+QByteArray plainSeparator(const QString &separator)
+{
+    QByteArray result;
+
+    for (int i = 0; i < separator.size(); ++i) {
+        QChar c = separator[i];
+
+        if (c == '\\') {
+            if (++i == separator.size())
+                return QByteArray();
+
+            c = separator[i];
+            if (c == 'n')
+                c = '\n';
+            else if (c == 't')
+                c = '\t';
+            else if (c == 'r')
+                c = '\r';
+            else if ( c.isLetterOrNumber() )
+                return QByteArray(); // character class or back reference
+        } else if ( QString(".^$*+?()[]{}|").contains(c) ) {
+            return QByteArray();
+        }
+
+        if (c.unicode() > 127)
+            return QByteArray();
+
+        result.append( c.toLatin1() );
+    }
+
+    return result;
+}
+
+/** Return position of @a separator in @a data starting at @a from or -1. */
+int indexOfSeparator(const QByteArray &data, const QByteArray &separator, int from)
+{
+    if (separator.size() != 1)
+        return data.indexOf(separator, from);
+
+    const char *begin = data.constData();
+    const void *found = memchr(begin + from, separator[0], data.size() - from);
+    return found != NULL ? static_cast<const char *>(found) - begin : -1;
+}
+
+/**
+ * Return size of item with at most @a maxSize bytes starting at @a from
+ * (avoids splitting multi-byte UTF-8 characters).
+ */
+int splitItemSize(const QByteArray &data, int from, int maxSize)
+{
+    int end = from + maxSize;
+    for (int i = 0; i < 3 && end - 1 > from && (data[end] & 0xc0) == 0x80; ++i)
+        --end;
+    return end - from;
+}
+
+/** Return size of @a text in bytes in local 8-bit encoding. */
+int localTextSize(const QString &text)
+{
+    return QTextCodec::codecForLocale()->fromUnicode(text).size();
+}
+
+/**
+ * Return number of characters of @a text starting at @a from which take at
+ * most @a maxSize bytes in local 8-bit encoding (at least one character).
+ */
+int splitTextSize(const QString &text, int from, int maxSize)
+{
+    // Each character takes at least one byte.
+    QTextCodec *codec = QTextCodec::codecForLocale();
+    const QString part = text.mid(from, maxSize);
+    const QByteArray bytes = codec->fromUnicode(part);
+    if (bytes.size() <= maxSize)
+        return part.size();
+
+    // Incomplete multi-byte character at the end is not decoded.
+    QScopedPointer<QTextDecoder> decoder( codec->makeDecoder() );
+    int size = decoder->toUnicode( bytes.constData(), maxSize ).size();
+    if ( size > 1 && text[from + size - 1].isHighSurrogate() )
+        --size;
+    return qMax(1, size);
+}
+
+} // namespace
+
 Action::Action(const Commands &cmd,
                const QByteArray &input, const QString &outputItemFormat,
                const QString &itemSeparator,
@@ -32,8 +143,20 @@ Action::Action(const Commands &cmd,
     , m_index(index)
     , m_errstr()
     , m_lastOutput()
+    , m_lastOutputSize(0)
+    , m_outputData()
+    , m_sepBytes(index.isValid() ? QByteArray() : plainSeparator(itemSeparator))
+    , m_scannedSize(0)
+    , m_decoder( QTextCodec::codecForLocale()->makeDecoder() )
+    , m_maxItemSize(0)
+    , m_maxOutputSize(0)
+    , m_outputDiscarded(false)
     , m_failed(false)
     , m_firstProcess(NULL)
+    , m_inputProcess(NULL)
+    , m_inputOffset(0)
+    , m_name()
+    , m_automatic(false)
 {
     setProcessChannelMode(QProcess::SeparateChannels);
     connect( this, SIGNAL(error(QProcess::ProcessError)),
@@ -51,6 +174,10 @@ Action::Action(const Commands &cmd,
     }
 }
 
+Action::~Action()
+{
+}
+
 QString Action::command() const
 {
     QString text;
@@ -100,11 +227,13 @@ void Action::actionStarted()
     if (m_firstProcess == NULL)
         return;
 
-    // write input
-    if ( !m_input.isEmpty() )
-        m_firstProcess->write( m_input );
-    m_firstProcess->closeWriteChannel();
+    // Write input in chunks so the input (possibly large data shared with an
+    // item) is not copied whole into process write buffer.
+    m_inputProcess = m_firstProcess;
     m_firstProcess = NULL;
+    connect( m_inputProcess, SIGNAL(bytesWritten(qint64)),
+             SLOT(writeInput()) );
+    writeInput();
 
     emit actionStarted(this);
 }
@@ -119,17 +248,21 @@ void Action::actionFinished()
                 emit newItem(m_outputData, m_outputFormat, m_tab);
             m_outputData = QByteArray();
         }
-    } else if ( !m_lastOutput.isNull() ) {
-        actionOutput();
-        if ( !m_lastOutput.isNull() ) {
-            QStringList items;
+    } else {
+        QStringList items;
+
+        // Last item (don't add empty item if output ends with separator).
+        if ( !m_sepBytes.isEmpty() || m_sep.isEmpty() ) {
+            if ( m_sep.isEmpty() ? !m_outputData.isNull() : !m_outputData.isEmpty() )
+                items.append( QString::fromLocal8Bit(m_outputData) );
+            m_outputData = QByteArray();
+        } else if ( !m_lastOutput.isEmpty() ) {
             items.append(m_lastOutput);
-            if (m_index.isValid())
-                emit newItems(items, m_index);
-            else
-                emit newItems(items, m_tab);
             m_lastOutput = QString();
         }
+
+        if ( !items.isEmpty() )
+            emitItems(items);
     }
 
     emit actionFinished(this);
@@ -137,19 +270,107 @@ void Action::actionFinished()
 
 void Action::actionOutput()
 {
+    const QByteArray output = readAll();
+
     if (!m_outputFormat.isEmpty()) {
-        m_outputData.append( readAll() );
+        appendOutputData(output);
         return;
     }
 
-    m_lastOutput.append( QString::fromLocal8Bit(readAll()) );
-    if ( m_lastOutput.isEmpty() || m_sep.isEmpty() )
+    QStringList items;
+    splitOutput(output, &items);
+    if ( !items.isEmpty() )
+        emitItems(items);
+}
+
+void Action::splitOutput(const QByteArray &output, QStringList *items)
+{
+    if ( m_sep.isEmpty() ) {
+        appendOutputData(output);
         return;
+    }
 
-    // Split to items.
-    QStringList items;
-    items = m_lastOutput.split(m_sep);
-    m_lastOutput = items.takeLast();
+    if ( m_sepBytes.isEmpty() ) {
+        // Separator is regular expression -- search only new text (and end
+        // of previous text if separator is split between chunks).
+        m_lastOutput.append( m_decoder->toUnicode(output) );
+        m_lastOutputSize += output.size();
+
+        int from = 0;
+        int pos = m_sep.indexIn( m_lastOutput, qMax(0, m_scannedSize - maxRegExpSeparatorLength) );
+        while (pos != -1) {
+            const int length = m_sep.matchedLength();
+            if (length > 0) {
+                items->append( m_lastOutput.mid(from, pos - from) );
+                m_lastOutputSize -= localTextSize( m_lastOutput.mid(from, pos + length - from) );
+                from = pos + length;
+                pos = m_sep.indexIn(m_lastOutput, from);
+            } else {
+                // Skip empty match.
+                pos = pos < m_lastOutput.size() ? m_sep.indexIn(m_lastOutput, pos + 1) : -1;
+            }
+        }
+
+        if (m_maxItemSize > 0) {
+            while (m_lastOutputSize > m_maxItemSize && from < m_lastOutput.size()) {
+                const QString item = m_lastOutput.mid( from, splitTextSize(m_lastOutput, from, m_maxItemSize) );
+                items->append(item);
+                m_lastOutputSize -= localTextSize(item);
+                from += item.size();
+            }
+        }
+
+        m_lastOutput.remove(0, from);
+        m_scannedSize = m_lastOutput.size();
+        return;
+    }
+
+    // Search only new bytes (and end of previous output if separator is longer).
+    m_outputData.append(output);
+
+    const int sepSize = m_sepBytes.size();
+    const char *data = m_outputData.constData();
+    int from = 0;
+    int pos = indexOfSeparator( m_outputData, m_sepBytes, qMax(0, m_scannedSize - sepSize + 1) );
+    while (pos != -1) {
+        items->append( QString::fromLocal8Bit(data + from, pos - from) );
+        from = pos + sepSize;
+        pos = indexOfSeparator(m_outputData, m_sepBytes, from);
+    }
+
+    if (m_maxItemSize > 0) {
+        while (m_outputData.size() - from > m_maxItemSize) {
+            const int size = splitItemSize(m_outputData, from, m_maxItemSize);
+            items->append( QString::fromLocal8Bit(data + from, size) );
+            from += size;
+        }
+    }
+
+    if (from > 0)
+        m_outputData.remove(0, from);
+    m_scannedSize = m_outputData.size();
+}
+
+void Action::appendOutputData(const QByteArray &output)
+{
+    if (m_outputDiscarded)
+        return;
+
+    if ( m_maxOutputSize > 0 && output.size() > m_maxOutputSize - m_outputData.size() ) {
+        m_outputData.append( output.left(m_maxOutputSize - m_outputData.size()) );
+        m_outputDiscarded = true;
+        const QString msg = tr("Output is larger than %1 bytes, rest of the output was discarded.")
+                .arg(m_maxOutputSize);
+        m_errstr += msg + '\n';
+        log( QString("%1: %2").arg(command()).arg(msg), LogWarning );
+        return;
+    }
+
+    m_outputData.append(output);
+}
+
+void Action::emitItems(const QStringList &items)
+{
     if (m_index.isValid())
         emit newItems(items, m_index);
     else
@@ -161,6 +382,30 @@ void Action::actionErrorOutput()
     m_errstr += QString::fromLocal8Bit( readAllStandardError() );
 }
 
+void Action::writeInput()
+{
+    if (m_inputProcess == NULL)
+        return;
+
+    // Keep at most two chunks in write buffer.
+    if ( m_inputProcess->bytesToWrite() >= inputChunkSize )
+        return;
+
+    if ( m_inputOffset < m_input.size() ) {
+        const int size = qMin( inputChunkSize, m_input.size() - m_inputOffset );
+        m_inputProcess->write( m_input.constData() + m_inputOffset, size );
+        m_inputOffset += size;
+    }
+
+    if ( m_inputOffset >= m_input.size() ) {
+        // Write channel is closed after rest of the buffered input is written.
+        disconnect( m_inputProcess, SIGNAL(bytesWritten(qint64)),
+                    this, SLOT(writeInput()) );
+        m_inputProcess->closeWriteChannel();
+        m_inputProcess = NULL;
+    }
+}
+
 void Action::terminate()
 {
     // try to terminate process
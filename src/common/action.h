@@ -22,9 +22,11 @@
 
 #include <QModelIndex>
 #include <QProcess>
+#include <QScopedPointer>
 #include <QStringList>
 
 class QAction;
+class QTextDecoder;
 
 /**
  * Execute external program.
@@ -46,6 +48,8 @@ public:
             const QModelIndex &index //!< Output item index.
             );
 
+    ~Action();
+
     /** Return true only if command execution failed. */
     bool actionFailed() const { return m_failed; }
 
@@ -61,6 +65,40 @@ public:
     /** Return input. */
     const QByteArray &input() const { return m_input; }
 
+    /** Return tab name for output items. */
+    const QString &outputTabName() const { return m_tab; }
+
+    /** Set name of the command (e.g. command line before expanding arguments). */
+    void setName(const QString &name) { m_name = name; }
+
+    /** Return name of the command. */
+    const QString &name() const { return m_name; }
+
+    /**
+     * If true, the action was started automatically for new clipboard content.
+     *
+     * Number of running automatic actions is limited and the action can be
+     * replaced with newer one for same command before it's started (see
+     * ActionScheduler).
+     */
+    void setAutomatic(bool automatic) { m_automatic = automatic; }
+
+    /** Return true if action was started automatically. */
+    bool isAutomatic() const { return m_automatic; }
+
+    /**
+     * Set maximum size of a single output item in bytes.
+     *
+     * Longer text output without separator is split into more items.
+     */
+    void setMaxItemSize(int bytes) { m_maxItemSize = bytes; }
+
+    /**
+     * Set maximum size of standard output buffered until the command finishes
+     * (used if the output is a single item). Rest of the output is discarded.
+     */
+    void setMaxOutputSize(int bytes) { m_maxOutputSize = bytes; }
+
     /** Execute command. */
     void start();
 
@@ -72,10 +110,29 @@ private:
     const QString m_outputFormat;
     const QModelIndex m_index;
     QString m_errstr;
-    QString m_lastOutput;
-    QByteArray m_outputData;
+    QString m_lastOutput; //!< Text not yet split (separator is regular expression).
+    int m_lastOutputSize; //!< Size of m_lastOutput in bytes (as received from process).
+    QByteArray m_outputData; //!< Output not yet split or output for single item.
+    const QByteArray m_sepBytes; //!< Encoded separator if it's not a regular expression.
+    int m_scannedSize; //!< Size of output not yet split already searched for separator.
+    QScopedPointer<QTextDecoder> m_decoder;
+    int m_maxItemSize;
+    int m_maxOutputSize;
+    bool m_outputDiscarded;
     bool m_failed;
     QProcess *m_firstProcess; //!< First process in pipe.
+    QProcess *m_inputProcess; //!< Process receiving rest of the input.
+    int m_inputOffset; //!< Size of input already passed to m_inputProcess.
+    QString m_name;
+    bool m_automatic;
+
+    /** Split text output to items and append them to @a items. */
+    void splitOutput(const QByteArray &output, QStringList *items);
+
+    /** Append single item output; discard it if it exceeds maximum output size. */
+    void appendOutputData(const QByteArray &output);
+
+    void emitItems(const QStringList &items);
 
 private slots:
     void actionError(QProcess::ProcessError error);
@@ -83,6 +140,8 @@ private slots:
     void actionFinished();
     void actionOutput();
     void actionErrorOutput();
+    /** Pass next chunk of input to first process. */
+    void writeInput();
 
 public slots:
     /** Terminate (kill) process. */
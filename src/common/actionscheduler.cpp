@@ -0,0 +1,182 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/actionscheduler.h"
+
+#include "common/action.h"
+#include "common/client_server.h"
+
+ActionScheduler::ActionScheduler(QObject *parent)
+    : QObject(parent)
+    , m_maxRunning(1)
+    , m_running()
+    , m_queues()
+    , m_queueOrder()
+    , m_queuedCount(0)
+    , m_maxQueuedCount(0)
+    , m_started(0)
+    , m_coalesced(0)
+    , m_waitTime()
+{
+}
+
+ActionScheduler::~ActionScheduler()
+{
+    foreach (const QList<QueuedAction> &queue, m_queues) {
+        foreach (const QueuedAction &queued, queue)
+            delete queued.action;
+    }
+}
+
+void ActionScheduler::setMaxRunning(int maxRunning)
+{
+    m_maxRunning = qMax(1, maxRunning);
+    startQueued();
+}
+
+void ActionScheduler::schedule(Action *action)
+{
+    if ( !action->isAutomatic() ) {
+        COPYQ_LOG( QString("Action \"%1\" started by user.").arg(action->command()) );
+        action->start();
+        return;
+    }
+
+    connect( action, SIGNAL(actionFinished(Action*)),
+             this, SLOT(onActionFinished(Action*)) );
+
+    if ( m_running.size() < m_maxRunning && m_queuedCount == 0 ) {
+        start(action, 0);
+        return;
+    }
+
+    const QString name = action->name().isEmpty() ? action->command() : action->name();
+    QList<QueuedAction> &queue = m_queues[name];
+
+    // Replace outdated action for same command.
+    for (int i = 0; i < queue.size(); ++i) {
+        Action *queuedAction = queue[i].action;
+        if ( queuedAction->outputTabName() == action->outputTabName() ) {
+            COPYQ_LOG( QString("Action \"%1\" superseded by newer one.").arg(name) );
+            queue[i].action = action;
+            ++m_coalesced;
+            drop(queuedAction);
+            return;
+        }
+    }
+
+    QueuedAction queued;
+    queued.action = action;
+    queued.waitTime.start();
+    queue.append(queued);
+
+    if ( !m_queueOrder.contains(name) )
+        m_queueOrder.append(name);
+
+    ++m_queuedCount;
+    m_maxQueuedCount = qMax(m_maxQueuedCount, m_queuedCount);
+
+    COPYQ_LOG( QString("Action \"%1\" queued (%2 waiting).").arg(name).arg(m_queuedCount) );
+}
+
+bool ActionScheduler::cancel(Action *action)
+{
+    for ( QMap< QString, QList<QueuedAction> >::iterator it = m_queues.begin();
+          it != m_queues.end(); ++it )
+    {
+        QList<QueuedAction> &queue = it.value();
+        for (int i = 0; i < queue.size(); ++i) {
+            if (queue[i].action == action) {
+                queue.removeAt(i);
+                if ( queue.isEmpty() ) {
+                    m_queueOrder.removeOne( it.key() );
+                    m_queues.erase(it);
+                }
+                --m_queuedCount;
+                COPYQ_LOG( QString("Queued action \"%1\" canceled.").arg(action->command()) );
+                drop(action);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+QVariantMap ActionScheduler::stats() const
+{
+    QVariantMap stats;
+    stats["max_running"] = m_maxRunning;
+    stats["running"] = m_running.size();
+    stats["queued"] = m_queuedCount;
+    stats["max_queued"] = m_maxQueuedCount;
+    stats["started"] = m_started;
+    stats["coalesced"] = m_coalesced;
+    stats["wait_time"] = m_waitTime.toString();
+
+    foreach ( const QString &name, m_queues.keys() ) {
+        const int size = m_queues[name].size();
+        if (size > 0)
+            stats["queue: " + name] = size;
+    }
+
+    return stats;
+}
+
+void ActionScheduler::onActionFinished(Action *action)
+{
+    disconnect( action, SIGNAL(actionFinished(Action*)),
+                this, SLOT(onActionFinished(Action*)) );
+
+    if ( m_running.remove(action) )
+        startQueued();
+}
+
+void ActionScheduler::startQueued()
+{
+    while ( m_running.size() < m_maxRunning && !m_queueOrder.isEmpty() ) {
+        const QString name = m_queueOrder.takeFirst();
+        QList<QueuedAction> &queue = m_queues[name];
+        const QueuedAction queued = queue.takeFirst();
+
+        if ( queue.isEmpty() )
+            m_queues.remove(name);
+        else
+            m_queueOrder.append(name);
+
+        --m_queuedCount;
+        start( queued.action, queued.waitTime.elapsed() );
+    }
+}
+
+void ActionScheduler::start(Action *action, qint64 waitTimeMs)
+{
+    m_running.insert(action);
+    ++m_started;
+    m_waitTime.addSample(waitTimeMs);
+    action->start();
+}
+
+void ActionScheduler::drop(Action *action)
+{
+    disconnect( action, SIGNAL(actionFinished(Action*)),
+                this, SLOT(onActionFinished(Action*)) );
+    emit actionDropped(action);
+    action->deleteLater();
+}
@@ -0,0 +1,115 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ACTIONSCHEDULER_H
+#define ACTIONSCHEDULER_H
+
+#include "common/latencyhistogram.h"
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QVariantMap>
+
+class Action;
+
+/**
+ * Limits number of automatic actions running at the same time.
+ *
+ * Actions started by user are started immediately. Automatic actions (see
+ * Action::isAutomatic()) which cannot be started immediately wait in a queue
+ * for their command (see Action::name()). Queues are served in round-robin
+ * fashion so single command cannot block others.
+ *
+ * Automatic action waiting in queue is replaced by newer automatic action
+ * with the same command and output (its input is outdated).
+ */
+class ActionScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ActionScheduler(QObject *parent = NULL);
+
+    /** Delete actions which haven't been started. */
+    ~ActionScheduler();
+
+    /** Set maximum number of actions running at the same time (at least one). */
+    void setMaxRunning(int maxRunning);
+
+    /** Start @a action or queue it if too many automatic actions are running. */
+    void schedule(Action *action);
+
+    /**
+     * Remove @a action from queue (emits actionDropped()).
+     *
+     * Returns false if the action is not waiting in queue.
+     */
+    bool cancel(Action *action);
+
+    /** Return number of running automatic actions. */
+    int runningCount() const { return m_running.size(); }
+
+    /** Return number of actions waiting to be started. */
+    int queuedCount() const { return m_queuedCount; }
+
+    /** Return statistics (queue depth, waiting times etc.). */
+    QVariantMap stats() const;
+
+signals:
+    /**
+     * Queued @a action was superseded by newer one or canceled and won't be
+     * started. The action is deleted later.
+     */
+    void actionDropped(Action *action);
+
+private slots:
+    void onActionFinished(Action *action);
+
+private:
+    struct QueuedAction {
+        Action *action;
+        QElapsedTimer waitTime;
+    };
+
+    /** Start actions from queues while limit allows it. */
+    void startQueued();
+
+    void start(Action *action, qint64 waitTimeMs);
+
+    /** Emit actionDropped() and delete @a action later. */
+    void drop(Action *action);
+
+    int m_maxRunning;
+    QSet<Action*> m_running;
+
+    QMap< QString, QList<QueuedAction> > m_queues;
+    /** Names of non-empty queues in order they should be served. */
+    QStringList m_queueOrder;
+    int m_queuedCount;
+
+    int m_maxQueuedCount;
+    int m_started;
+    int m_coalesced;
+    LatencyHistogram m_waitTime;
+};
+
+#endif // ACTIONSCHEDULER_H
@@ -21,7 +21,6 @@
 
 #include <QByteArray>
 #include <QDataStream>
-#include <QFile>
 #include <QDir>
 
 namespace {
@@ -60,12 +59,14 @@ void addArgumentFromCommandLine(QVector<QByteArray> &args, const char *arg, int
 
 Arguments::Arguments()
     : m_args()
+    , m_stdinArgument(-1)
 {
     reset(QDir::currentPath());
 }
 
 Arguments::Arguments(int argc, char **argv, int skipArgc)
     : m_args()
+    , m_stdinArgument(-1)
 {
     reset(QDir::currentPath());
 
@@ -81,9 +82,10 @@ Arguments::Arguments(int argc, char **argv, int skipArgc)
         } else {
             if ( arg[0] == '-' ) {
                 if ( arg[1] == '\0' ) {
-                    QFile in;
-                    in.open(stdin, QIODevice::ReadOnly);
-                    m_args.append( in.readAll() );
+                    // Only first argument gets the data (others would be empty).
+                    if (m_stdinArgument == -1)
+                        m_stdinArgument = m_args.size();
+                    m_args.append( QByteArray() );
                     continue;
                 } else if ( arg[2] == '\0' ) {
                     // single-char option
@@ -101,6 +103,51 @@ Arguments::Arguments(int argc, char **argv, int skipArgc)
     }
 }
 
+Arguments::Arguments(const QByteArray &commandLine)
+    : m_args()
+    , m_stdinArgument(-1)
+{
+    reset(QDir::currentPath());
+
+    QByteArray arg;
+    bool hasArg = false;
+    bool escape = false;
+    char quote = '\0';
+    foreach (char ch, commandLine) {
+        if (escape) {
+            escape = false;
+            if (ch == 'n')
+                arg.append('\n');
+            else if (ch == 't')
+                arg.append('\t');
+            else
+                arg.append(ch);
+        } else if (ch == '\\') {
+            escape = hasArg = true;
+        } else if (quote != '\0') {
+            if (ch == quote)
+                quote = '\0';
+            else
+                arg.append(ch);
+        } else if (ch == '\'' || ch == '"') {
+            quote = ch;
+            hasArg = true;
+        } else if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
+            if (hasArg) {
+                m_args.append(arg);
+                arg.clear();
+                hasArg = false;
+            }
+        } else {
+            arg.append(ch);
+            hasArg = true;
+        }
+    }
+
+    if (hasArg)
+        m_args.append(arg);
+}
+
 Arguments::~Arguments()
 {
 }
@@ -108,6 +155,7 @@ Arguments::~Arguments()
 void Arguments::reset(const QString &currentPath)
 {
     m_args.clear();
+    m_stdinArgument = -1;
     if (!currentPath.isNull())
         m_args << currentPath.toLatin1();
 }
@@ -117,6 +165,11 @@ void Arguments::append(const QByteArray &argument)
     m_args.append(argument);
 }
 
+void Arguments::replace(int index, const QByteArray &argument)
+{
+    m_args[index] = argument;
+}
+
 const QByteArray &Arguments::at(int index) const
 {
     return m_args.at(index);
@@ -138,20 +191,21 @@ QDataStream &operator <<(QDataStream &stream, const Arguments &args)
 QDataStream &operator>>(QDataStream &stream, Arguments &args)
 {
     int len;
-    uint arg_len;
-    char *buffer;
+    quint32 arg_len;
 
     args.reset();
     stream >> len;
-    for( int i = 0; i<len; ++i ) {
-        stream.readBytes(buffer, arg_len);
-        if (buffer) {
-            QByteArray arg(buffer, arg_len);
-            delete[] buffer;
-            args.append(arg);
-        } else {
-            args.append(QByteArray());
+    for( int i = 0; i<len && stream.status() == QDataStream::Ok; ++i ) {
+        // Read directly into argument to avoid copying possibly large data.
+        stream >> arg_len;
+        QByteArray arg;
+        if ( stream.device() == NULL || arg_len > stream.device()->bytesAvailable() ) {
+            stream.setStatus(QDataStream::ReadCorruptData);
+        } else if (arg_len > 0) {
+            arg.resize(arg_len);
+            stream.readRawData( arg.data(), arg_len );
         }
+        args.append(arg);
     }
 
     return stream;
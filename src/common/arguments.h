@@ -30,6 +30,10 @@ class QByteArray;
  *
  * Arguments object can be constructed using standard arguments of main()
  * (i.e. argc and argv). Arguments can be added using append().
+ *
+ * Argument "-" (data from standard input) is left empty and its index is
+ * returned by stdinArgument() so that the data can be streamed to server
+ * instead of reading everything into memory first.
  */
 class Arguments
 {
@@ -42,6 +46,15 @@ public:
     Arguments();
     Arguments(int argc, char **argv, int skipArgc = 1);
 
+    /**
+     * Create arguments from single line of text (e.g. read from batch file).
+     *
+     * Arguments are separated by white space. Quotes ('' or "") enclose
+     * arguments containing white space. Backslash escape sequences are same as
+     * for program arguments.
+     */
+    explicit Arguments(const QByteArray &commandLine);
+
     ~Arguments();
 
     /** Clear arguments and set current path. */
@@ -50,6 +63,9 @@ public:
     /** Append argument. */
     void append(const QByteArray &argument);
 
+    /** Replace argument at @a index. */
+    void replace(int index, const QByteArray &argument);
+
     /** Get argument by @a index. */
     const QByteArray &at(int index) const;
 
@@ -59,8 +75,12 @@ public:
     /** Check for emptiness. */
     bool isEmpty() const { return m_args.empty(); }
 
+    /** Index of argument to read from standard input (-1 if there is none). */
+    int stdinArgument() const { return m_stdinArgument; }
+
 private:
     QVector<QByteArray> m_args;
+    int m_stdinArgument;
 };
 
 /**
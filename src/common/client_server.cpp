@@ -22,6 +22,7 @@
 #include <QAction>
 #include <QApplication>
 #include <QClipboard>
+#include <QDataStream>
 #include <QFile>
 #include <QLocalServer>
 #include <QLocalSocket>
@@ -34,6 +35,9 @@
 
 const QString mimeWindowTitle = "application/x-copyq-owner-window-title";
 const QString mimeItemNotes = "application/x-copyq-item-notes";
+const QString mimeMonitorStats = "application/x-copyq-monitor-stats";
+const QString mimeMonitorPing = "application/x-copyq-monitor-ping";
+const QString mimeMonitorPong = "application/x-copyq-monitor-pong";
 
 QString escapeHtml(const QString &str)
 {
@@ -118,6 +122,16 @@ bool readMessage(QIODevice *socket, QByteArray *msg)
     return false;
 }
 
+bool canReadMessage(QIODevice *socket)
+{
+    quint32 len;
+    if ( socket->bytesAvailable() < static_cast<qint64>(sizeof(len)) )
+        return false;
+
+    QDataStream( socket->peek(sizeof(len)) ) >> len;
+    return socket->bytesAvailable() >= static_cast<qint64>(sizeof(len) + len);
+}
+
 void writeMessage(QIODevice *socket, const QByteArray &msg)
 {
     COPYQ_LOG( QString("Write message (%1 bytes).").arg(msg.size()) );
@@ -208,6 +222,47 @@ QMimeData *cloneData(const QMimeData &data, const QStringList *formats)
     return newdata;
 }
 
+QByteArray serializeData(const QMimeData &data)
+{
+    const QStringList formats = data.formats();
+
+    // Preallocate message so large payloads are not reallocated while written.
+    int size = sizeof(qint32);
+    foreach (const QString &mime, formats)
+        size += 2 * sizeof(quint32) + 2 * mime.size() + data.data(mime).size();
+
+    QByteArray bytes;
+    bytes.reserve(size);
+
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out << static_cast<qint32>(formats.size());
+    foreach (const QString &mime, formats)
+        out << mime << data.data(mime);
+
+    return bytes;
+}
+
+bool deserializeData(QMimeData *data, const QByteArray &bytes)
+{
+    QDataStream in(bytes);
+
+    qint32 length;
+    in >> length;
+    if ( in.status() != QDataStream::Ok || length < 0 )
+        return false;
+
+    QString mime;
+    QByteArray payload;
+    for (qint32 i = 0; i < length; ++i) {
+        in >> mime >> payload;
+        if ( in.status() != QDataStream::Ok )
+            return false;
+        data->setData(mime, payload);
+    }
+
+    return true;
+}
+
 QString elideText(const QString &text, int maxLength, const QFontMetrics &fm)
 {
     const int oldLines = text.count('\n');
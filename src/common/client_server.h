@@ -81,6 +81,9 @@ enum LogLevel {
 
 extern const QString mimeWindowTitle;
 extern const QString mimeItemNotes;
+extern const QString mimeMonitorStats;
+extern const QString mimeMonitorPing;
+extern const QString mimeMonitorPong;
 
 QString escapeHtml(const QString &str);
 
@@ -92,6 +95,8 @@ const QMimeData *clipboardData(QClipboard::Mode mode = QClipboard::Clipboard);
 
 bool readBytes(QIODevice *socket, qint64 size, QByteArray *bytes);
 bool readMessage(QIODevice *socket, QByteArray *msg);
+/** Return true if whole message can be read from @a socket without waiting. */
+bool canReadMessage(QIODevice *socket);
 void writeMessage(QIODevice *socket, const QByteArray &msg);
 
 QLocalServer *newServer(const QString &name, QObject *parent=NULL);
@@ -101,8 +106,26 @@ QString clipboardMonitorServerName();
 
 uint hash(const QMimeData &data, const QStringList &formats);
 
+/**
+ * Create new data object with given @a formats (or all lowercase formats).
+ *
+ * Payload bytes are implicitly shared with @a data (no deep copy is made).
+ */
 QMimeData *cloneData(const QMimeData &data, const QStringList *formats=NULL);
 
+/**
+ * Serialize @a data for sending to other process.
+ *
+ * Unlike serialization of ClipboardItem, data are not compressed.
+ */
+QByteArray serializeData(const QMimeData &data);
+
+/**
+ * Deserialize @a bytes created with serializeData() into @a data.
+ * @return false if @a bytes are corrupted
+ */
+bool deserializeData(QMimeData *data, const QByteArray &bytes);
+
 QString elideText(const QString &text, int maxLength, const QFontMetrics &fm = QFontMetrics(QFont()));
 void elideText(QAction *act, bool escapeAmpersands);
 
@@ -0,0 +1,356 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/commandmatcher.h"
+
+#include "common/client_server.h"
+
+#include <QElapsedTimer>
+#include <QMimeData>
+#include <QMutexLocker>
+#include <QStringList>
+
+namespace {
+
+QChar foldCase(const QChar &c)
+{
+    return c.toLower();
+}
+
+/**
+ * Return longest literal text which must be present in any text matched by
+ * regular expression @a re (empty if there is no such text or the pattern is
+ * too complex).
+ */
+QString requiredLiteral(const QRegExp &re)
+{
+    const QString pattern = re.pattern();
+    const QRegExp::PatternSyntax syntax = re.patternSyntax();
+
+    if (syntax == QRegExp::FixedString) {
+        // Text is searched for literals with folded case.
+        QString literal;
+        literal.reserve( pattern.size() );
+        foreach (const QChar &c, pattern)
+            literal.append( foldCase(c) );
+        return literal;
+    }
+
+    if (syntax != QRegExp::RegExp && syntax != QRegExp::RegExp2)
+        return QString();
+
+    QString best;
+    QString current;
+    int depth = 0;
+
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+        QChar literal;
+        bool isLiteral = false;
+
+        if (c == '\\') {
+            if ( ++i == pattern.size() )
+                return QString();
+            // Escaped letters and digits are character classes, back-references
+            // or character codes.
+            const QChar e = pattern[i];
+            if ( !e.isLetterOrNumber() ) {
+                literal = e;
+                isLiteral = true;
+            } else if (e == 'x') {
+                for (int j = 0; j < 4 && i + 1 < pattern.size() && QString("0123456789abcdefABCDEF").contains(pattern[i + 1]); ++j)
+                    ++i;
+            } else if (e == '0') {
+                for (int j = 0; j < 3 && i + 1 < pattern.size() && pattern[i + 1].isDigit(); ++j)
+                    ++i;
+            }
+        } else if (c == '[') {
+            // Skip character class.
+            ++i;
+            if ( i < pattern.size() && pattern[i] == '^' )
+                ++i;
+            if ( i < pattern.size() && pattern[i] == ']' )
+                ++i;
+            while ( i < pattern.size() && pattern[i] != ']' ) {
+                if (pattern[i] == '\\')
+                    ++i;
+                ++i;
+            }
+        } else if (c == '(') {
+            ++depth;
+        } else if (c == ')') {
+            --depth;
+        } else if (c == '|') {
+            // Alternatives on top level don't share any required text.
+            if (depth == 0)
+                return QString();
+        } else if (c == '{') {
+            while ( i < pattern.size() && pattern[i] != '}' )
+                ++i;
+        } else if ( !QString(".^$*+?").contains(c) ) {
+            literal = c;
+            isLiteral = true;
+        }
+
+        if (isLiteral && depth == 0) {
+            const QChar quantifier = i + 1 < pattern.size() ? pattern[i + 1] : QChar();
+            if ( quantifier == '*' || quantifier == '?' || quantifier == '{' ) {
+                // Character is optional.
+                isLiteral = false;
+            } else {
+                current.append( foldCase(literal) );
+                // Repeated character ends the literal.
+                if (quantifier == '+')
+                    isLiteral = false;
+            }
+        }
+
+        if (!isLiteral || depth != 0) {
+            if ( current.size() > best.size() )
+                best = current;
+            current.clear();
+        }
+    }
+
+    return current.size() > best.size() ? current : best;
+}
+
+} // namespace
+
+CommandMatcher::CompiledCommand::CompiledCommand()
+    : command()
+    , literal(-1)
+    , windowPattern(-1)
+    , evaluated(0)
+    , matched(0)
+    , matchTimeNs(0)
+{
+}
+
+CommandMatcher::CommandMatcher()
+    : m_commands()
+    , m_literals()
+    , m_nodes(1)
+    , m_windowPatterns()
+    , m_statsMutex()
+{
+}
+
+void CommandMatcher::setCommands(const QList<Command> &commands)
+{
+    QMutexLocker lock(&m_statsMutex);
+
+    m_commands.clear();
+    m_literals.clear();
+    m_nodes = QVector<Node>(1);
+    m_windowPatterns.clear();
+
+    QStringList windowPatterns;
+
+    foreach (const Command &command, commands) {
+        if ( !command.automatic
+             || (!command.remove && command.cmd.isEmpty() && command.tab.isEmpty()) )
+        {
+            continue;
+        }
+
+        CompiledCommand c;
+        c.command = command;
+
+        const QString literal = requiredLiteral(command.re);
+        if ( !literal.isEmpty() )
+            c.literal = addLiteral(literal);
+
+        if ( !command.wndre.isEmpty() ) {
+            const QString windowPattern = command.wndre.pattern();
+            c.windowPattern = windowPatterns.indexOf(windowPattern);
+            if (c.windowPattern == -1) {
+                c.windowPattern = windowPatterns.size();
+                windowPatterns.append(windowPattern);
+                m_windowPatterns.append(command.wndre);
+            }
+        }
+
+        m_commands.append(c);
+    }
+
+    buildAutomaton();
+}
+
+QList<Command> CommandMatcher::match(const QMimeData &data, const QString &text)
+{
+    QList<Command> result;
+    if ( m_commands.isEmpty() )
+        return result;
+
+    const bool noText = !data.hasText();
+    const QString windowTitle = QString::fromUtf8( data.data(mimeWindowTitle).data() );
+
+    // Results for window patterns (-1 if not evaluated yet).
+    QVector<int> windowMatches( m_windowPatterns.size(), -1 );
+
+    QVector<bool> literals;
+    bool literalsSearched = false;
+
+    // Statistics are updated at the end so stats() doesn't wait for matching.
+    QVector<qint64> matchTimeNs( m_commands.size(), -1 );
+    QVector<bool> matched( m_commands.size(), false );
+
+    QElapsedTimer timer;
+
+    for (int i = 0; i < m_commands.size(); ++i) {
+        const CompiledCommand &c = m_commands[i];
+        const Command &command = c.command;
+
+        if ( !command.input.isEmpty() && !data.hasFormat(command.input) )
+            continue;
+
+        if ( noText && !command.re.isEmpty() )
+            continue;
+
+        timer.start();
+
+        bool matches = true;
+
+        if ( c.windowPattern != -1 && !windowTitle.isNull() ) {
+            int &windowMatch = windowMatches[c.windowPattern];
+            if (windowMatch == -1)
+                windowMatch = m_windowPatterns[c.windowPattern].indexIn(windowTitle) != -1 ? 1 : 0;
+            matches = windowMatch == 1;
+        }
+
+        if (matches && !noText) {
+            if (c.literal != -1) {
+                if (!literalsSearched) {
+                    literals = findLiterals(text);
+                    literalsSearched = true;
+                }
+                matches = literals[c.literal];
+            }
+
+            if (matches)
+                matches = command.re.indexIn(text) != -1;
+        }
+
+        matchTimeNs[i] = timer.nsecsElapsed();
+        matched[i] = matches;
+
+        if (matches)
+            result.append(command);
+    }
+
+    QMutexLocker lock(&m_statsMutex);
+    for (int i = 0; i < m_commands.size(); ++i) {
+        if (matchTimeNs[i] != -1) {
+            CompiledCommand &c = m_commands[i];
+            ++c.evaluated;
+            c.matchTimeNs += matchTimeNs[i];
+            if (matched[i])
+                ++c.matched;
+        }
+    }
+
+    return result;
+}
+
+QVariantMap CommandMatcher::stats() const
+{
+    QMutexLocker lock(&m_statsMutex);
+
+    QVariantMap stats;
+    for (int i = 0; i < m_commands.size(); ++i) {
+        const CompiledCommand &c = m_commands[i];
+        const QString name = c.command.name.isEmpty() ? c.command.cmd : c.command.name;
+        stats[ QString("command_%1 (%2)").arg(i).arg(name) ] =
+                QString("evaluated %1, matched %2, total %3 us")
+                .arg(c.evaluated)
+                .arg(c.matched)
+                .arg(c.matchTimeNs / 1000);
+    }
+
+    return stats;
+}
+
+int CommandMatcher::addLiteral(const QString &literal)
+{
+    if ( m_literals.contains(literal) )
+        return m_literals[literal];
+
+    const int index = m_literals.size();
+    m_literals[literal] = index;
+
+    int node = 0;
+    foreach (const QChar &c, literal) {
+        int next = m_nodes[node].next.value(c, 0);
+        if (next == 0) {
+            next = m_nodes.size();
+            m_nodes[node].next[c] = next;
+            m_nodes.append( Node() );
+        }
+        node = next;
+    }
+    m_nodes[node].literals.append(index);
+
+    return index;
+}
+
+void CommandMatcher::buildAutomaton()
+{
+    QList<int> queue = m_nodes[0].next.values();
+
+    for (int i = 0; i < queue.size(); ++i) {
+        const int node = queue[i];
+        foreach ( const QChar &c, m_nodes[node].next.keys() ) {
+            const int child = m_nodes[node].next[c];
+
+            int fail = m_nodes[node].fail;
+            while ( fail != 0 && !m_nodes[fail].next.contains(c) )
+                fail = m_nodes[fail].fail;
+
+            m_nodes[child].fail = m_nodes[fail].next.value(c, 0);
+            m_nodes[child].literals.append( m_nodes[m_nodes[child].fail].literals );
+
+            queue.append(child);
+        }
+    }
+}
+
+QVector<bool> CommandMatcher::findLiterals(const QString &text) const
+{
+    QVector<bool> found( m_literals.size(), false );
+    int remaining = m_literals.size();
+
+    int node = 0;
+    for (int i = 0; i < text.size() && remaining > 0; ++i) {
+        const QChar c = foldCase(text[i]);
+
+        while ( node != 0 && !m_nodes[node].next.contains(c) )
+            node = m_nodes[node].fail;
+        node = m_nodes[node].next.value(c, 0);
+
+        foreach (int literal, m_nodes[node].literals) {
+            if (!found[literal]) {
+                found[literal] = true;
+                --remaining;
+            }
+        }
+    }
+
+    return found;
+}
@@ -0,0 +1,115 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COMMANDMATCHER_H
+#define COMMANDMATCHER_H
+
+#include "common/command.h"
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QVariantMap>
+#include <QVector>
+
+class QMimeData;
+
+/**
+ * Finds automatic commands which should be run for new items.
+ *
+ * Commands are compiled once in setCommands(). When matching, commands are
+ * first filtered by input format and window title (each distinct window
+ * pattern is evaluated only once). Literal text required by each regular
+ * expression is searched for all commands at once in single pass over item
+ * text (using Aho-Corasick automaton) and full regular expressions are
+ * evaluated only for commands with the literal present in the text.
+ *
+ * Matching modifies state of regular expressions so an instance shouldn't be
+ * used from multiple threads at the same time (except stats()).
+ */
+class CommandMatcher
+{
+public:
+    CommandMatcher();
+
+    /** Compile automatic commands from @a commands (other commands are ignored). */
+    void setCommands(const QList<Command> &commands);
+
+    /** Return true if there are no automatic commands. */
+    bool isEmpty() const { return m_commands.isEmpty(); }
+
+    /**
+     * Return automatic commands which should be run for new item with given
+     * @a data.
+     *
+     * Argument @a text should contain text of the item (so it's not necessary
+     * to convert it again).
+     */
+    QList<Command> match(const QMimeData &data, const QString &text);
+
+    /**
+     * Return number of evaluations, matches and total time spent matching for
+     * each command.
+     */
+    QVariantMap stats() const;
+
+private:
+    struct CompiledCommand {
+        CompiledCommand();
+
+        Command command;
+        /** Index of literal required in text (-1 if text needs to be always matched). */
+        int literal;
+        /** Index of window title pattern (-1 if all windows are matched). */
+        int windowPattern;
+
+        int evaluated;
+        int matched;
+        qint64 matchTimeNs;
+    };
+
+    /** Node of Aho-Corasick automaton. */
+    struct Node {
+        Node() : next(), fail(0), literals() {}
+        QHash<QChar, int> next;
+        int fail;
+        /** Literals ending in this node. */
+        QList<int> literals;
+    };
+
+    /** Add literal to automaton and return its index. */
+    int addLiteral(const QString &literal);
+
+    /** Compute failure links and outputs for automaton. */
+    void buildAutomaton();
+
+    /** Return which literals are present in @a text. */
+    QVector<bool> findLiterals(const QString &text) const;
+
+    QVector<CompiledCommand> m_commands;
+    QHash<QString, int> m_literals;
+    QVector<Node> m_nodes;
+    QList<QRegExp> m_windowPatterns;
+
+    mutable QMutex m_statsMutex;
+
+    Q_DISABLE_COPY(CommandMatcher)
+};
+
+#endif // COMMANDMATCHER_H
@@ -0,0 +1,114 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/latencyhistogram.h"
+
+#include <QStringList>
+
+namespace {
+
+/// Last bucket contains all samples greater or equal to 2^(bucketCount - 2) ms.
+const int bucketCount = 14;
+
+int bucketIndex(qint64 ms)
+{
+    int i = 0;
+    while (ms > 0 && i < bucketCount - 1) {
+        ms >>= 1;
+        ++i;
+    }
+    return i;
+}
+
+QString bucketLabel(int i)
+{
+    if (i == 0)
+        return "0";
+
+    const qint64 from = Q_INT64_C(1) << (i - 1);
+    if (i == bucketCount - 1)
+        return QString(">=%1").arg(from);
+
+    const qint64 to = (from << 1) - 1;
+    return from == to ? QString::number(from) : QString("%1-%2").arg(from).arg(to);
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram()
+    : m_buckets(bucketCount, 0)
+    , m_count(0)
+    , m_sum(0)
+    , m_max(0)
+{
+}
+
+void LatencyHistogram::addSample(qint64 ms)
+{
+    if (ms < 0)
+        ms = 0;
+
+    ++m_buckets[bucketIndex(ms)];
+    ++m_count;
+    m_sum += ms;
+    m_max = qMax(m_max, ms);
+}
+
+qint64 LatencyHistogram::average() const
+{
+    return m_count == 0 ? 0 : m_sum / m_count;
+}
+
+qint64 LatencyHistogram::percentile(int percent) const
+{
+    if (m_count == 0)
+        return 0;
+
+    const qint64 rank = (static_cast<qint64>(m_count) * percent + 99) / 100;
+    qint64 seen = 0;
+    for (int i = 0; i < bucketCount - 1; ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank)
+            return qMin( i == 0 ? Q_INT64_C(0) : (Q_INT64_C(1) << i) - 1, m_max );
+    }
+
+    return m_max;
+}
+
+QString LatencyHistogram::toString() const
+{
+    QStringList buckets;
+    for (int i = 0; i < bucketCount; ++i) {
+        if (m_buckets[i] > 0)
+            buckets.append( QString("%1 ms: %2").arg(bucketLabel(i)).arg(m_buckets[i]) );
+    }
+
+    QString result = QString("count %1, avg %2 ms, p50 %3 ms, p90 %4 ms, p99 %5 ms, max %6 ms")
+            .arg(m_count)
+            .arg(average())
+            .arg(percentile(50))
+            .arg(percentile(90))
+            .arg(percentile(99))
+            .arg(m_max);
+
+    if ( !buckets.isEmpty() )
+        result.append("; " + buckets.join(", "));
+
+    return result;
+}
@@ -0,0 +1,71 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QString>
+#include <QVector>
+
+/**
+ * Histogram of latencies in milliseconds.
+ *
+ * Bucket sizes grow exponentially (0 ms, 1 ms, 2-3 ms, 4-7 ms, ...) so the
+ * histogram stays small and cheap to update.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    /** Add latency sample (in milliseconds). */
+    void addSample(qint64 ms);
+
+    /** Return number of samples. */
+    int count() const { return m_count; }
+
+    /** Return maximum latency. */
+    qint64 maximum() const { return m_max; }
+
+    /** Return average latency (0 if there are no samples). */
+    qint64 average() const;
+
+    /**
+     * Return latency which @a percent of samples don't exceed.
+     *
+     * Result is upper bound of the bucket containing the percentile (but never
+     * greater than maximum()).
+     */
+    qint64 percentile(int percent) const;
+
+    /**
+     * Return human readable summary.
+     *
+     * Contains number of samples, average, median, 90th and 99th percentile and
+     * maximum latency and sample counts for non-empty buckets.
+     */
+    QString toString() const;
+
+private:
+    QVector<int> m_buckets;
+    int m_count;
+    qint64 m_sum;
+    qint64 m_max;
+};
+
+#endif // LATENCYHISTOGRAM_H
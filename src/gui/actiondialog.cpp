@@ -29,6 +29,8 @@
 #include <QFile>
 #include <QMessageBox>
 #include <QMimeData>
+#include <QTextCodec>
+#include <QTextDocument>
 
 namespace {
 
@@ -44,6 +46,11 @@ void setChangedByUser(QWidget *object)
     object->setProperty("UserChanged", object->hasFocus());
 }
 
+bool isLocaleUtf8()
+{
+    return QTextCodec::codecForLocale()->mibEnum() == 106;
+}
+
 } // namespace
 
 ActionDialog::ActionDialog(QWidget *parent)
@@ -51,6 +58,9 @@ ActionDialog::ActionDialog(QWidget *parent)
     , ui(new Ui::ActionDialog)
     , m_re()
     , m_data(NULL)
+    , m_index()
+    , m_automatic(false)
+    , m_inputTextOutdated(false)
 {
     ui->setupUi(this);
 
@@ -140,8 +150,15 @@ void ActionDialog::createAction()
         return;
 
     const QString format = ui->comboBoxInputFormat->currentText();
-    const QString input = ( format.isEmpty() || format.toLower().startsWith(QString("text")) )
-            ? ui->inputText->toPlainText() : QString();
+    const bool textInput = format.isEmpty() || format.toLower().startsWith(QString("text"));
+
+    // Input data is not copied unless the text was modified in dialog.
+    const bool inputModified = m_data == NULL || ui->inputText->document()->isModified();
+
+    // Text is needed only for arguments (%1, %2 etc.).
+    QString input;
+    if ( textInput && cmd.contains('%') )
+        input = inputModified ? ui->inputText->toPlainText() : inputText(format);
 
     // parse arguments
     Action::Commands commands;
@@ -208,8 +225,11 @@ void ActionDialog::createAction()
 
     QByteArray data;
     if ( !format.isEmpty() ) {
-        if ( !input.isEmpty() )
-            data = input.toLocal8Bit();
+        if (textInput && inputModified)
+            data = ui->inputText->toPlainText().toLocal8Bit();
+        // Text is passed in locale encoding (same as if it was modified in dialog).
+        else if ( textInput && !isLocaleUtf8() )
+            data = inputText(format).toLocal8Bit();
         else if (m_data != NULL)
             data = m_data->data(format);
     }
@@ -219,6 +239,8 @@ void ActionDialog::createAction()
                               ui->separatorEdit->text(),
                               ui->comboBoxOutputTab->currentText(),
                               m_index );
+    act->setName(cmd);
+    act->setAutomatic(m_automatic);
     emit accepted(act);
 
     close();
@@ -291,6 +313,8 @@ void ActionDialog::saveSettings()
 void ActionDialog::showEvent(QShowEvent *e)
 {
     QDialog::showEvent(e);
+    if (m_inputTextOutdated)
+        loadInputText();
     ConfigurationManager::instance()->loadGeometry(this);
     updateMinimalGeometry();
 }
@@ -387,15 +411,30 @@ void ActionDialog::on_comboBoxInputFormat_currentIndexChanged(const QString &for
     bool show = format.toLower().startsWith(QString("text"));
     ui->inputText->setVisible(show);
 
-    QString text;
-    if ((show || format.isEmpty()) && m_data != NULL) {
-        text = format.isEmpty() ? m_data->text() : QString::fromLocal8Bit(m_data->data(format));
-    }
-    ui->inputText->setPlainText(text);
+    if ( isVisible() )
+        loadInputText();
+    else
+        m_inputTextOutdated = true;
 
     updateMinimalGeometry();
 }
 
+QString ActionDialog::inputText(const QString &format) const
+{
+    if (m_data == NULL)
+        return QString();
+    return format.isEmpty() ? m_data->text() : QString::fromLocal8Bit(m_data->data(format));
+}
+
+void ActionDialog::loadInputText()
+{
+    const QString format = ui->comboBoxInputFormat->currentText();
+    const bool show = format.isEmpty() || format.toLower().startsWith(QString("text"));
+    ui->inputText->setPlainText( show ? inputText(format) : QString() );
+    ui->inputText->document()->setModified(false);
+    m_inputTextOutdated = false;
+}
+
 void ActionDialog::on_comboBoxOutputFormat_editTextChanged(const QString &text)
 {
     setChangedByUser(ui->comboBoxOutputFormat);
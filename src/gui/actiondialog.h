@@ -65,6 +65,8 @@ public:
     void setRegExp(const QRegExp &re);
     /** Set output item. */
     void setOutputIndex(const QModelIndex &index);
+    /** Create automatic action (see Action::setAutomatic()). */
+    void setAutomatic(bool automatic) { m_automatic = automatic; }
 
     /** Load settings. */
     void loadSettings();
@@ -81,6 +83,14 @@ private:
     QRegExp m_re;
     QMimeData *m_data;
     QModelIndex m_index;
+    bool m_automatic;
+    bool m_inputTextOutdated;
+
+    /** Return input data as text for given @a format. */
+    QString inputText(const QString &format) const;
+
+    /** Show input text in dialog (only when it's visible, text can be large). */
+    void loadInputText();
 
 signals:
     /** Emitted if dialog was accepted. */
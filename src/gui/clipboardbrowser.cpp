@@ -108,6 +108,7 @@ ClipboardBrowserShared::ClipboardBrowserShared()
     , maxImageHeight(100)
     , textWrap(true)
     , commands()
+    , automaticCommands()
     , viMode(false)
     , saveOnReturnKey(false)
     , moveItemOnReturnKey(false)
@@ -125,6 +126,7 @@ void ClipboardBrowserShared::loadFromConfiguration()
     maxImageHeight = cm->value("max_image_height").toInt();
     textWrap = cm->value("text_wrap").toBool();
     commands = cm->commands();
+    automaticCommands.setCommands(commands);
     viMode = cm->value("vi").toBool();
     saveOnReturnKey = !cm->value("edit_ctrl_return").toBool();
     moveItemOnReturnKey = cm->value("move").toBool();
@@ -784,11 +786,50 @@ bool ClipboardBrowser::openEditor(const QModelIndex &index)
     return editor != NULL && startEditor(editor);
 }
 
-void ClipboardBrowser::addItems(const QStringList &items)
+void ClipboardBrowser::addItems(const QStringList &items, int row)
 {
-    for(int i=items.count()-1; i>=0; --i) {
-        add(items[i], true);
+    if ( items.isEmpty() || !canAddItems() )
+        return;
+
+    const int newRow = row < 0 ? m->rowCount() : qMin(row, m->rowCount());
+
+    // Don't create items which would be removed immediately because of list size limit.
+    const int count = qMin( items.size(), m_sharedData->maxItems - newRow );
+    if (count <= 0)
+        return;
+
+    QList<QMimeData *> dataList;
+    dataList.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        QMimeData *data = new QMimeData;
+        data->setText(items[i]);
+        dataList.append(data);
     }
+
+    // Item widgets are created later only for visible items.
+    m->insertItems(newRow, dataList);
+
+    // filter items
+    int firstVisibleRow = -1;
+    for (int i = newRow; i < newRow + count; ++i) {
+        if ( isFiltered(i) )
+            setRowHidden(i, true);
+        else if (firstVisibleRow == -1)
+            firstVisibleRow = i;
+    }
+
+    // Select first new item if clipboard is not focused and the item is not filtered-out.
+    if ( firstVisibleRow != -1 && !hasFocus() ) {
+        clearSelection();
+        setCurrentIndex( index(firstVisibleRow) );
+    }
+
+    // list size limit
+    const int rowCount = m->rowCount();
+    if ( rowCount > m_sharedData->maxItems )
+        m->removeRows( m_sharedData->maxItems, rowCount - m_sharedData->maxItems );
+
+    delayedSaveItems();
 }
 
 void ClipboardBrowser::showItemContent()
@@ -809,6 +850,31 @@ void ClipboardBrowser::removeRow(int row)
     model()->removeRow(row);
 }
 
+void ClipboardBrowser::removeRows(const QVariantList &rows)
+{
+    const int rowCount = m->rowCount();
+
+    QList<int> sortedRows;
+    foreach (const QVariant &value, rows) {
+        const int row = value.toInt();
+        if (row >= 0 && row < rowCount)
+            sortedRows.append(row);
+    }
+
+    // Remove from last row so row numbers don't change.
+    qSort( sortedRows.begin(), sortedRows.end(), qGreater<int>() );
+
+    int i = 0;
+    while ( i < sortedRows.size() ) {
+        const int last = sortedRows[i];
+        int first = last;
+        for ( ++i; i < sortedRows.size() && sortedRows[i] >= first - 1; ++i )
+            first = sortedRows[i];
+
+        m->removeRows(first, last - first + 1);
+    }
+}
+
 void ClipboardBrowser::editNotes()
 {
     QModelIndex ind = currentIndex();
@@ -1177,55 +1243,70 @@ bool ClipboardBrowser::add(const QString &txt, bool force, int row)
 
 bool ClipboardBrowser::add(QMimeData *data, bool force, int row)
 {
-    if ( editing() )
+    if ( !canAddItems() )
         return false;
 
-    if ( !m_loaded && !m_id.isEmpty() ) {
-        loadItems();
-        if (!m_loaded)
-            return false;
+    const uint dataHash = hash( *data, data->formats() );
+
+    if (force) {
+        insertItem(data, dataHash, row);
+        return true;
+    }
+
+    const QString text = data->text();
+    return add( data, dataHash, m_sharedData->automaticCommands.match(*data, text), row );
+}
+
+bool ClipboardBrowser::add(QMimeData *data, uint dataHash, const QList<Command> &commands, int row)
+{
+    if ( !canAddItems() )
+        return false;
+
+    // don't add if new data is same as first item
+    if ( m->rowCount() > 0 && m->at(0)->dataHash() == dataHash ) {
+        delete data;
+        return false;
     }
 
-    if (!force) {
-        // don't add if new data is same as first item
-        if ( m->rowCount() > 0 && *m->at(0) == *data ) {
+    // commands
+    foreach (const Command &c, commands) {
+        Command cmd = c;
+        if ( cmd.outputTab.isEmpty() )
+            cmd.outputTab = m_id;
+        emit runAutomaticCommand(*data, cmd);
+        if (!c.tab.isEmpty())
+            emit addToTab(data, c.tab);
+        if (c.remove) {
             delete data;
             return false;
         }
+    }
 
-        // commands
-        bool noText = !data->hasText();
-        const QString text = data->text();
-        const QString windowTitle = QString::fromUtf8( data->data(mimeWindowTitle).data() );
-        foreach (const Command &c, m_sharedData->commands) {
-            if (c.automatic && (c.remove || !c.cmd.isEmpty() || !c.tab.isEmpty())) {
-                if ( ((noText && c.re.isEmpty()) || (!noText && c.re.indexIn(text) != -1))
-                     && (c.input.isEmpty() || data->hasFormat(c.input))
-                     && (windowTitle.isNull() || c.wndre.indexIn(windowTitle) != -1) )
-                {
-                    if (c.automatic) {
-                        Command cmd = c;
-                        if ( cmd.outputTab.isEmpty() )
-                            cmd.outputTab = m_id;
-                        if ( cmd.input.isEmpty() || data->hasFormat(cmd.input) )
-                            emit requestActionDialog(*data, cmd);
-                    }
-                    if (!c.tab.isEmpty())
-                        emit addToTab(data, c.tab);
-                    if (c.remove) {
-                        delete data;
-                        return false;
-                    }
-                }
-            }
-        }
+    insertItem(data, dataHash, row);
+    return true;
+}
+
+bool ClipboardBrowser::canAddItems()
+{
+    if ( editing() )
+        return false;
+
+    if ( !m_loaded && !m_id.isEmpty() ) {
+        loadItems();
+        if (!m_loaded)
+            return false;
     }
 
+    return true;
+}
+
+void ClipboardBrowser::insertItem(QMimeData *data, uint dataHash, int row)
+{
     // create new item
     int newRow = row < 0 ? m->rowCount() : qMin(row, m->rowCount());
     m->insertRow(newRow);
     QModelIndex ind = index(newRow);
-    m->setData(ind, data);
+    m->setData(ind, data, dataHash);
 
     // filter item
     if ( isFiltered(newRow) ) {
@@ -1241,8 +1322,6 @@ bool ClipboardBrowser::add(QMimeData *data, bool force, int row)
         m->removeRow( m->rowCount() - 1 );
 
     delayedSaveItems();
-
-    return true;
 }
 
 bool ClipboardBrowser::add(const ClipboardItem &item, bool force, int row)
@@ -1342,6 +1421,17 @@ const QMimeData *ClipboardBrowser::itemData(int i) const
     return m->mimeDataInRow( i>=0 ? i : currentIndex().row() );
 }
 
+int ClipboardBrowser::publishedLength() const
+{
+    return m->publishedRowCount();
+}
+
+void ClipboardBrowser::itemSnapshots(
+        const QVariantList &rows, QList<ClipboardItemSnapshotPtr> *snapshots) const
+{
+    m->itemSnapshots(rows, snapshots);
+}
+
 void ClipboardBrowser::updateClipboard(int row)
 {
     if ( row < m->rowCount() )
@@ -1357,6 +1447,14 @@ QByteArray ClipboardBrowser::itemData(int i, const QString &mime) const
     return mime == "?" ? data->formats().join("\n").toUtf8() + '\n' : data->data(mime);
 }
 
+QVariantList ClipboardBrowser::itemsData(const QVariantList &rows, const QString &mime) const
+{
+    QVariantList result;
+    foreach (const QVariant &row, rows)
+        result.append( itemData(row.toInt(), mime) );
+    return result;
+}
+
 void ClipboardBrowser::editRow(int row)
 {
     editItem( index(row) );
@@ -21,12 +21,12 @@
 #define CLIPBOARDBROWSER_H
 
 #include "common/command.h"
+#include "common/commandmatcher.h"
+#include "item/clipboardmodel.h"
 
 #include <QListView>
 #include <QSharedPointer>
 
-class ClipboardItem;
-class ClipboardModel;
 class ItemDelegate;
 class QMimeData;
 class QTimer;
@@ -43,6 +43,8 @@ struct ClipboardBrowserShared {
     int maxImageHeight;
     bool textWrap;
     QList<Command> commands;
+    /** Matches new items against automatic commands. */
+    CommandMatcher automaticCommands;
     bool viMode;
     bool saveOnReturnKey;
     bool moveItemOnReturnKey;
@@ -83,6 +85,20 @@ class ClipboardBrowser : public QListView
                 int row = 0 //!< Target row for the new item.
                 );
 
+        /**
+         * Add new item to the browser.
+         *
+         * Same as add(data) but uses precomputed @a dataHash (same as
+         * hash(*data, data->formats())) and automatic @a commands matching the
+         * data (see CommandMatcher).
+         */
+        bool add(
+                QMimeData *data, //!< Data for new item.
+                uint dataHash, //!< Hash of the data.
+                const QList<Command> &commands, //!< Automatic commands to run.
+                int row = 0 //!< Target row for the new item (negative to append item).
+                );
+
         /** Remove all items. */
         void clear();
 
@@ -108,6 +124,16 @@ class ClipboardBrowser : public QListView
         QString itemText(QModelIndex ind) const;
         /** Data of item in given row or current row. */
         const QMimeData *itemData(int i = -1) const;
+
+        /** Return number of items (thread-safe, see ClipboardModel::publishedRowCount()). */
+        int publishedLength() const;
+
+        /**
+         * Return snapshots of items in given @a rows (thread-safe).
+         * @see ClipboardModel::itemSnapshots()
+         */
+        void itemSnapshots(const QVariantList &rows,
+                           QList<ClipboardItemSnapshotPtr> *snapshots) const;
         /** Index of item in given row. */
         QModelIndex index(int i) const { return model()->index(i,0); }
         /** Return clipboard item at given row. */
@@ -229,6 +255,12 @@ class ClipboardBrowser : public QListView
 
         void editItem(const QModelIndex &index);
 
+        /** Load items if needed, return false if items cannot be added. */
+        bool canAddItems();
+
+        /** Insert new item (without checking commands and duplicates). */
+        void insertItem(QMimeData *data, uint dataHash, int row);
+
     protected:
         void closeEditor(QWidget *editor, QAbstractItemDelegate::EndEditHint hint);
         void keyPressEvent(QKeyEvent *event);
@@ -245,6 +277,8 @@ class ClipboardBrowser : public QListView
         void requestActionDialog(const QMimeData &data, const Command &cmd);
         /** Action dialog requested. */
         void requestActionDialog(const QMimeData &data, const Command &cmd, const QModelIndex &index);
+        /** Automatic command matched new item. */
+        void runAutomaticCommand(const QMimeData &data, const Command &cmd);
         /** Show list request. */
         void requestShow(const ClipboardBrowser *self);
         /** Hide main window. */
@@ -314,8 +348,12 @@ class ClipboardBrowser : public QListView
                         const QString &editorCommand = QString());
         /** Open editor for an item. */
         bool openEditor(const QModelIndex &index);
-        /** Add items. */
-        void addItems(const QStringList &items);
+        /**
+         * Add text items (first item in @a items will be at @a row).
+         *
+         * Items are inserted at once, commands and duplicates are ignored.
+         */
+        void addItems(const QStringList &items, int row = 0);
 
         /** Show content of current item. */
         void showItemContent();
@@ -327,6 +365,13 @@ class ClipboardBrowser : public QListView
 
         void removeRow(int row);
 
+        /**
+         * Remove items in @a rows (list of integers).
+         *
+         * Consecutive rows are removed at once.
+         */
+        void removeRows(const QVariantList &rows);
+
         /** Edit notes for current item. */
         void editNotes();
 
@@ -384,6 +429,12 @@ class ClipboardBrowser : public QListView
          */
         QByteArray itemData(int i, const QString &mime) const;
 
+        /**
+         * Data of items in given @a rows (list of integers) as list of byte arrays.
+         * @see itemData()
+         */
+        QVariantList itemsData(const QVariantList &rows, const QString &mime) const;
+
         /** Edit item in given @a row. */
         void editRow(int row);
 };
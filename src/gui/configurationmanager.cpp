@@ -539,6 +539,9 @@ void ConfigurationManager::initOptions()
     /* other options */
     bind("tabs", QStringList());
     bind("command_history_size", 100);
+    bind("max_running_commands", 4);
+    bind("max_command_output_item_size", 16 * 1024 * 1024);
+    bind("max_command_output_size", 256 * 1024 * 1024);
     bind("_last_hash", 0);
 #ifndef NO_GLOBAL_SHORTCUTS
     /* shortcuts -- generate options from UI (button text is key for shortcut option) */
@@ -976,6 +979,7 @@ void ConfigurationManager::loadSettings()
     const QStringList pluginPriority =
             settings.value("plugin_priority", QStringList()).toStringList();
     ItemFactory::instance()->setPluginPriority(pluginPriority);
+    ItemFactory::instance()->updateFormatLoaders();
 
     // reload plugin widgets
     while ( ui->tabWidgetPlugins->count() > 0 )
@@ -1066,6 +1070,7 @@ void ConfigurationManager::saveSettings()
         pluginPriority.append( ui->tabWidgetPlugins->tabText(i) );
     settings.setValue("plugin_priority", pluginPriority);
     ItemFactory::instance()->setPluginPriority(pluginPriority);
+    ItemFactory::instance()->updateFormatLoaders();
 
     updateFormats();
 
@@ -21,6 +21,7 @@
 #include "ui_mainwindow.h"
 
 #include "common/action.h"
+#include "common/actionscheduler.h"
 #include "common/client_server.h"
 #include "common/command.h"
 #include "common/contenttype.h"
@@ -171,6 +172,9 @@ MainWindow::MainWindow(QWidget *parent)
     , m_actionMonitoringDisabled()
     , m_clearFirstTab(false)
     , m_actions()
+    , m_actionScheduler( new ActionScheduler(this) )
+    , m_maxCommandOutputItemSize(0)
+    , m_maxCommandOutputSize(0)
     , m_sharedData(new ClipboardBrowserShared)
     , m_trayItemPaste(true)
     , m_trayPasteWindow()
@@ -179,6 +183,7 @@ MainWindow::MainWindow(QWidget *parent)
     , m_timerUpdateFocusWindows( new QTimer(this) )
     , m_timerGeometry( new QTimer(this) )
     , m_sessionName()
+    , m_stats()
 {
     ui->setupUi(this);
 
@@ -213,6 +218,8 @@ MainWindow::MainWindow(QWidget *parent)
              this, SLOT(updateFocusWindows()) );
     connect( this, SIGNAL(changeClipboard(const ClipboardItem*)),
              this, SLOT(clipboardChanged(const ClipboardItem*)) );
+    connect( m_actionScheduler, SIGNAL(actionDropped(Action*)),
+             this, SLOT(actionDropped(Action*)) );
 
     // settings
     loadSettings();
@@ -475,8 +482,37 @@ void MainWindow::closeAction(Action *action)
     if ( !msg.isEmpty() )
         showMessage( tr("Command \"%1\"").arg(action->command()), msg );
 
-    delete m_actions.take(action);
+    removeActionMenuItem(action);
     action->deleteLater();
+}
+
+void MainWindow::addActionMenuItem(Action *action)
+{
+    QString text = tr("KILL") + " " + action->command();
+    QString tooltip = tr("<b>COMMAND:</b>") + '\n' + escapeHtml(text) + '\n' +
+                      tr("<b>INPUT:</b>") + '\n' +
+                      escapeHtml( QString::fromLocal8Bit(action->input()) );
+
+    QAction *act = m_actions[action] = new QAction(text, this);
+    act->setToolTip(tooltip);
+
+    connect( act, SIGNAL(triggered()),
+             this, SLOT(onActionMenuItemTriggered()) );
+
+    cmdMenu->addAction(act);
+    cmdMenu->setEnabled(true);
+
+    updateIcon();
+
+    elideText(act, true);
+}
+
+void MainWindow::removeActionMenuItem(Action *action)
+{
+    // Menu item can be removed while handling its signal.
+    QAction *act = m_actions.take(action);
+    if (act != NULL)
+        act->deleteLater();
 
     if ( m_actions.isEmpty() ) {
         cmdMenu->setEnabled(false);
@@ -525,6 +561,49 @@ void MainWindow::updateMonitoringActions()
     }
 }
 
+ClipboardBrowser *MainWindow::browserForNewItem(const QString &tabName)
+{
+    if (m_monitoringDisabled)
+        return NULL;
+
+    ClipboardBrowser *c = tabName.isEmpty() ? browser(0) : findBrowser(tabName);
+
+    if ( c == NULL && !tabName.isEmpty() )
+        c = createTab(tabName, true);
+
+    if (c != NULL)
+        c->loadItems();
+
+    return c;
+}
+
+bool MainWindow::mergeWithFirstItem(ClipboardBrowser *browser, QMimeData *data, const QString &text)
+{
+    if ( browser->length() == 0 )
+        return false;
+
+    ClipboardItem *first = browser->at(0);
+    const QString firstItemText = first->text();
+    if ( text != firstItemText && (
+             data->data(mimeWindowTitle) != first->data()->data(mimeWindowTitle)
+             || !(text.startsWith(firstItemText) || text.endsWith(firstItemText))) )
+    {
+        return false;
+    }
+
+    QStringList formats = data->formats();
+    const QMimeData *firstData = first->data();
+    foreach (const QString &format, firstData->formats()) {
+        if ( !formats.contains(format) )
+            data->setData( format, firstData->data(format) );
+    }
+    // remove merged item (if it's not edited)
+    if (!browser->editing() || browser->currentIndex().row() != 0)
+        browser->model()->removeRow(0);
+
+    return true;
+}
+
 ClipboardBrowser *MainWindow::findBrowser(const QModelIndex &index)
 {
     if (!index.isValid())
@@ -651,6 +730,8 @@ ClipboardBrowser *MainWindow::createTab(const QString &name, bool save)
              this, SLOT(action(const QMimeData&, const Command&)) );
     connect( c, SIGNAL(requestActionDialog(const QMimeData&, const Command&, const QModelIndex&)),
              this, SLOT(action(const QMimeData&, const Command&, const QModelIndex&)) );
+    connect( c, SIGNAL(runAutomaticCommand(const QMimeData&, const Command&)),
+             this, SLOT(automaticAction(const QMimeData&, const Command&)) );
     connect( c, SIGNAL(requestActionDialog(const QMimeData&)),
              this, SLOT(openActionDialog(const QMimeData&)) );
     connect( c, SIGNAL(requestShow(const ClipboardBrowser*)),
@@ -987,6 +1068,10 @@ void MainWindow::loadSettings()
     m_activatePastes = cm->value("activate_pastes").toBool();
 
     m_trayItems = cm->value("tray_items").toInt();
+
+    m_actionScheduler->setMaxRunning( cm->value("max_running_commands").toInt() );
+    m_maxCommandOutputItemSize = cm->value("max_command_output_item_size").toInt();
+    m_maxCommandOutputSize = cm->value("max_command_output_size").toInt();
     m_trayItemPaste = cm->value("tray_item_paste").toBool();
     m_trayCommands = cm->value("tray_commands").toBool();
     m_trayCurrentTab = cm->value("tray_tab_is_current").toBool();
@@ -1209,49 +1294,40 @@ void MainWindow::tabCloseRequested(int tab)
 
 void MainWindow::addToTab(const QMimeData *data, const QString &tabName, bool moveExistingToTop)
 {
-    if (m_monitoringDisabled)
-        return;
-
-    ClipboardBrowser *c = tabName.isEmpty() ? browser(0) : findBrowser(tabName);
-
-    if ( c == NULL && !tabName.isEmpty() )
-        c = createTab(tabName, true);
-
+    ClipboardBrowser *c = browserForNewItem(tabName);
     if (c == NULL)
         return;
 
-    c->loadItems();
-
     ClipboardBrowser::Lock lock(c);
     if ( !c->select(hash(*data, data->formats()), moveExistingToTop) ) {
         QMimeData *data2 = cloneData(*data);
         // force adding item if tab name is specified
         bool force = !tabName.isEmpty();
         // merge data with first item if it is same
-        if ( !force && c->length() > 0 && data2->hasText() ) {
-            ClipboardItem *first = c->at(0);
-            const QString newText = data2->text();
-            const QString firstItemText = first->text();
-            if ( newText == firstItemText || (
-                     data2->data(mimeWindowTitle) == first->data()->data(mimeWindowTitle)
-                     && (newText.startsWith(firstItemText) || newText.endsWith(firstItemText))) )
-            {
-                force = true;
-                QStringList formats = data2->formats();
-                const QMimeData *firstData = first->data();
-                foreach (const QString &format, firstData->formats()) {
-                    if ( !formats.contains(format) )
-                        data2->setData( format, firstData->data(format) );
-                }
-                // remove merged item (if it's not edited)
-                if (!c->editing() || c->currentIndex().row() != 0)
-                    c->model()->removeRow(0);
-            }
-        }
+        if ( !force && data2->hasText() && mergeWithFirstItem(c, data2, data2->text()) )
+            force = true;
         c->add(data2, force);
     }
 }
 
+void MainWindow::addClipboardData(QMimeData *data, uint dataHash, const QString &text,
+                                  const QList<Command> &commands)
+{
+    ClipboardBrowser *c = browserForNewItem(QString());
+    if (c == NULL) {
+        delete data;
+        return;
+    }
+
+    ClipboardBrowser::Lock lock(c);
+    if ( c->select(dataHash, true) )
+        delete data;
+    else if ( data->hasText() && mergeWithFirstItem(c, data, text) )
+        c->add(data, true);
+    else
+        c->add(data, dataHash, commands);
+}
+
 void MainWindow::nextTab()
 {
     ui->tabWidget->nextTab();
@@ -1341,6 +1417,25 @@ void MainWindow::pasteToCurrentWindow()
     platform->pasteToWindow( platform->getPasteWindow() );
 }
 
+void MainWindow::setStats(const QString &source, const QVariantMap &stats)
+{
+    m_stats[source] = stats;
+}
+
+QString MainWindow::stats() const
+{
+    QMap<QString, QVariantMap> allStats = m_stats;
+    allStats["actions"] = m_actionScheduler->stats();
+
+    QString result;
+    foreach ( const QString &source, allStats.keys() ) {
+        const QVariantMap &stats = allStats[source];
+        foreach ( const QString &name, stats.keys() )
+            result.append( QString("%1/%2: %3\n").arg(source).arg(name).arg(stats[name].toString()) );
+    }
+    return result;
+}
+
 ClipboardBrowser *MainWindow::getTabForTrayMenu()
 {
     return m_trayCurrentTab ? browser()
@@ -1350,8 +1445,14 @@ ClipboardBrowser *MainWindow::getTabForTrayMenu()
 void MainWindow::addItems(const QStringList &items, const QString &tabName)
 {
     ClipboardBrowser *c = tabName.isEmpty() ? browser() : createTab(tabName, true);
-    foreach (const QString &item, items)
-        c->add(item, true);
+
+    // Last item is on top.
+    QStringList reversedItems;
+    reversedItems.reserve( items.size() );
+    for (int i = items.size() - 1; i >= 0; --i)
+        reversedItems.append(items[i]);
+
+    c->addItems(reversedItems);
 }
 
 void MainWindow::addItems(const QStringList &items, const QModelIndex &index)
@@ -1391,26 +1492,20 @@ void MainWindow::onTimerSearch()
     browser()->filterItems(txt);
 }
 
-void MainWindow::actionStarted(Action *action)
+void MainWindow::onActionMenuItemTriggered()
 {
-    // menu item
-    QString text = tr("KILL") + " " + action->command();
-    QString tooltip = tr("<b>COMMAND:</b>") + '\n' + escapeHtml(text) + '\n' +
-                      tr("<b>INPUT:</b>") + '\n' +
-                      escapeHtml( QString::fromLocal8Bit(action->input()) );
-
-    QAction *act = m_actions[action] = new QAction(text, this);
-    act->setToolTip(tooltip);
-
-    connect( act, SIGNAL(triggered()),
-             action, SLOT(terminate()) );
-
-    cmdMenu->addAction(act);
-    cmdMenu->setEnabled(true);
+    Action *action = m_actions.key( qobject_cast<QAction*>(sender()) );
+    if (action == NULL)
+        return;
 
-    updateIcon();
+    // Action waiting in queue has no process to terminate.
+    if ( !m_actionScheduler->cancel(action) )
+        action->terminate();
+}
 
-    elideText(act, true);
+void MainWindow::actionDropped(Action *action)
+{
+    removeActionMenuItem(action);
 }
 
 void MainWindow::actionFinished(Action *action)
@@ -1475,17 +1570,18 @@ void MainWindow::updateTrayMenuItems()
 
     ClipboardBrowser *c = getTabForTrayMenu();
 
-    trayMenu->clearClipboardItemActions();
     trayMenu->clearCustomActions();
 
-    // Add items.
+    // Update items (only actions for changed items are recreated).
+    QList<const ClipboardItem *> items;
     const int len = (c != NULL) ? qMin( m_trayItems, c->length() ) : 0;
-    const int current = c->currentIndex().row();
     for ( int i = 0; i < len; ++i ) {
         const ClipboardItem *item = c->at(i);
         if (item != NULL)
-            trayMenu->addClipboardItemAction(*item, m_trayImages, i == current);
+            items.append(item);
     }
+    const int current = (c != NULL) ? c->currentIndex().row() : -1;
+    trayMenu->setClipboardItemActions(items, m_trayImages, current);
 
     // Add commands.
     if (m_trayCommands) {
@@ -1814,18 +1910,33 @@ void MainWindow::action(Action *action)
              this, SLOT(addItem(QByteArray, QString, QString)) );
     connect( action, SIGNAL(newItem(QByteArray, QString, QModelIndex)),
              this, SLOT(addItem(QByteArray, QString, QModelIndex)) );
-    connect( action, SIGNAL(actionStarted(Action*)),
-             this, SLOT(actionStarted(Action*)) );
     connect( action, SIGNAL(actionFinished(Action*)),
              this, SLOT(actionFinished(Action*)) );
     connect( action, SIGNAL(actionError(Action*)),
              this, SLOT(actionError(Action*)) );
 
+    action->setMaxItemSize(m_maxCommandOutputItemSize);
+    action->setMaxOutputSize(m_maxCommandOutputSize);
+
+    // Menu item is available while action waits in queue so it can be canceled.
+    addActionMenuItem(action);
+
     log( tr("Executing: %1").arg(action->command()) );
-    action->start();
+    m_actionScheduler->schedule(action);
 }
 
 void MainWindow::action(const QMimeData &data, const Command &cmd, const QModelIndex &outputIndex)
+{
+    startCommand(data, cmd, outputIndex, false);
+}
+
+void MainWindow::automaticAction(const QMimeData &data, const Command &cmd)
+{
+    startCommand(data, cmd, QModelIndex(), true);
+}
+
+void MainWindow::startCommand(const QMimeData &data, const Command &cmd,
+                              const QModelIndex &outputIndex, bool automatic)
 {
     ActionDialog *actionDialog = createActionDialog();
     QString outputTab;
@@ -1854,6 +1965,7 @@ void MainWindow::action(const QMimeData &data, const Command &cmd, const QModelI
     } else {
         // Create action without showing action dialog.
         actionDialog->setOutputTabs(QStringList(), outputTab);
+        actionDialog->setAutomatic(automatic);
         actionDialog->createAction();
         actionDialog->deleteLater();
     }
@@ -27,12 +27,15 @@
 #include <QPointer>
 #include <QSharedPointer>
 #include <QSystemTrayIcon>
+#include <QVariantMap>
 
 class AboutDialog;
 class Action;
 class ActionDialog;
+class ActionScheduler;
 class ClipboardBrowser;
 class ClipboardItem;
+struct Command;
 class QAction;
 class QMimeData;
 class TrayMenu;
@@ -208,6 +211,14 @@ class MainWindow : public QMainWindow
         void action(const QMimeData &data, const Command &cmd,
                     const QModelIndex &outputIndex = QModelIndex());
 
+        /**
+         * Execute automatic command for new item.
+         *
+         * If command has to wait for other commands to finish, it can be
+         * replaced by the same command for a newer item.
+         */
+        void automaticAction(const QMimeData &data, const Command &cmd);
+
         /** Open tab creation dialog. */
         void newTab(const QString &name = QString());
         /** Open tab group renaming dialog. */
@@ -276,6 +287,23 @@ class MainWindow : public QMainWindow
                 //!< If item already exists, move it to top and select it.
                 );
 
+        /**
+         * Add new clipboard @a data to the first tab.
+         *
+         * Same as addToTab(data, QString(), true) but uses values computed in
+         * advance (e.g. in other thread).
+         *
+         * The @a data should contain only formats copied by cloneData() so
+         * @a dataHash is valid for the new item. Takes ownership of @a data.
+         */
+        void addClipboardData(
+                QMimeData *data, //!< New clipboard data.
+                uint dataHash, //!< Same as hash(*data, data->formats()).
+                const QString &text, //!< Text of the data.
+                const QList<Command> &commands
+                //!< Automatic commands matching the data (see CommandMatcher).
+                );
+
         /** Set next or first tab as current. */
         void nextTab();
         /** Set previous or last tab as current. */
@@ -303,6 +331,15 @@ class MainWindow : public QMainWindow
         /** Paste clipboard content to current window. */
         void pasteToCurrentWindow();
 
+        /**
+         * Set performance statistics from given @a source (e.g. "monitor").
+         * Previous statistics from the source are replaced.
+         */
+        void setStats(const QString &source, const QVariantMap &stats);
+
+        /** Return performance statistics as text (one "SOURCE/NAME: VALUE" per line). */
+        QString stats() const;
+
     private slots:
         ClipboardBrowser *getTabForTrayMenu();
         void updateTrayMenuItems();
@@ -321,7 +358,8 @@ class MainWindow : public QMainWindow
         void addItem(const QByteArray &data, const QString &format, const QModelIndex &index);
         void onTimerSearch();
 
-        void actionStarted(Action *action);
+        void onActionMenuItemTriggered();
+        void actionDropped(Action *action);
         void actionFinished(Action *action);
         void actionError(Action *action);
 
@@ -340,6 +378,12 @@ class MainWindow : public QMainWindow
         /** Delete finished action and its menu item. */
         void closeAction(Action *action);
 
+        /** Add menu item for running or queued @a action (triggering it kills the action). */
+        void addActionMenuItem(Action *action);
+
+        /** Remove menu item for @a action. */
+        void removeActionMenuItem(Action *action);
+
         /** Update tray and window icon depending on current state. */
         void updateIcon();
 
@@ -348,9 +392,27 @@ class MainWindow : public QMainWindow
         /** Update name and icon of "disable/enable monitoring" menu actions. */
         void updateMonitoringActions();
 
+        /** Open action dialog for command or create action directly. */
+        void startCommand(const QMimeData &data, const Command &cmd,
+                          const QModelIndex &outputIndex, bool automatic);
+
         /** Return browser containing item or NULL. */
         ClipboardBrowser *findBrowser(const QModelIndex &index);
 
+        /**
+         * Return browser for adding new item to tab with given name (first tab
+         * if empty) or NULL if items shouldn't be added.
+         */
+        ClipboardBrowser *browserForNewItem(const QString &tabName);
+
+        /**
+         * Merge @a data with first item in @a browser if it has same or similar
+         * @a text (first item is removed).
+         *
+         * @return true only if data were merged
+         */
+        bool mergeWithFirstItem(ClipboardBrowser *browser, QMimeData *data, const QString &text);
+
         /** Return browser with given ID. */
         ClipboardBrowser *findBrowser(const QString &id);
 
@@ -413,6 +475,9 @@ class MainWindow : public QMainWindow
         bool m_clearFirstTab;
 
         QMap<Action*, QAction*> m_actions;
+        ActionScheduler *m_actionScheduler;
+        int m_maxCommandOutputItemSize;
+        int m_maxCommandOutputSize;
 
         QSharedPointer<ClipboardBrowserShared> m_sharedData;
 
@@ -425,6 +490,8 @@ class MainWindow : public QMainWindow
         QTimer *m_timerGeometry;
 
         QString m_sessionName;
+
+        QMap<QString, QVariantMap> m_stats;
     };
 
 #endif // MAINWINDOW_H
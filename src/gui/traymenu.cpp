@@ -27,15 +27,18 @@
 
 #include <QApplication>
 #include <QDesktopWidget>
+#include <QHash>
 #include <QKeyEvent>
 #include <QMimeData>
 #include <QPainter>
 #include <QPixmap>
+#include <QSet>
 #include <QToolTip>
 
 namespace {
 
 const char propertyHasToolTip[] = "CopyQ_has_tooltip";
+const char propertyElidedText[] = "CopyQ_elided_text";
 
 void removeAllActions(QList<QPointer<QAction> > *actions, QMenu *menu)
 {
@@ -80,6 +83,53 @@ void showTooltipForAction(const QString &text, QAction *action, QMenu *menu)
     QToolTip::showText( menu->mapToGlobal(pos), text, menu );
 }
 
+QPixmap iconForItem(const ClipboardItem &item)
+{
+    const QStringList formats = item.data(contentType::formats).toStringList();
+    int i = 0;
+    for ( ; i < formats.size(); ++i ) {
+        if (formats[i].startsWith("image/"))
+            break;
+    }
+    if ( i == formats.size() )
+        return QPixmap();
+
+    const QString &format = formats[i];
+    QPixmap pix;
+    pix.loadFromData( item.data()->data(format), format.toLatin1().data() );
+    if ( pix.isNull() )
+        return pix;
+
+    const int iconSize = 24;
+    int x = 0;
+    int y = 0;
+    if (pix.width() > pix.height()) {
+        pix = pix.scaledToHeight(iconSize);
+        x = (pix.width() - iconSize) / 2;
+    } else {
+        pix = pix.scaledToWidth(iconSize);
+        y = (pix.height() - iconSize) / 2;
+    }
+    return pix.copy(x, y, iconSize, iconSize);
+}
+
+/** Elide text of clipboard item action (stored in "What's This") to fit current @a menu font. */
+void updateElidedText(QAction *act, const QMenu &menu)
+{
+    const QFont font = act->font().resolve( menu.font() );
+    QString text = elideText( act->whatsThis(), -1, QFontMetrics(font) );
+    // Escape all ampersands.
+    text.replace( QChar('&'), QString("&&") );
+    act->setProperty(propertyElidedText, text);
+}
+
+/** Set elided text of clipboard item action with number key hint for given @a row. */
+void setClipboardItemActionText(QAction *act, int row)
+{
+    const QString text = act->property(propertyElidedText).toString();
+    act->setText( row < 10 ? QString("&%1. %2").arg(row).arg(text) : text );
+}
+
 } // namespace
 
 TrayMenu::TrayMenu(QWidget *parent)
@@ -88,6 +138,7 @@ TrayMenu::TrayMenu(QWidget *parent)
     , m_customActionsSeparator()
     , m_clipboardItemActions()
     , m_customActions()
+    , m_showImages(false)
     , m_timerShowTooltip()
 {
     connect( this, SIGNAL(hovered(QAction*)),
@@ -122,65 +173,67 @@ void TrayMenu::toggle()
     createPlatformNativeInterface()->raiseWindow(winId());
 }
 
-void TrayMenu::addClipboardItemAction(const ClipboardItem &item, bool showImages, bool isCurrent)
+void TrayMenu::setClipboardItemActions(const QList<const ClipboardItem *> &items,
+                                       bool showImages, int currentRow)
 {
-    QAction *act;
-
-    const int i = m_clipboardItemActions.size();
-
-    const QString text = item.text();
-    act = addAction(text);
-    act->setWhatsThis(text);
-    m_clipboardItemActions.append(act);
-
-    act->setData( QVariant(item.dataHash()) );
+    // Cached icons are no longer valid.
+    if (m_showImages != showImages) {
+        clearClipboardItemActions();
+        m_showImages = showImages;
+    }
 
     resetSeparators();
-    insertAction(m_clipboardItemActionsSeparator, act);
 
-    elideText(act, true);
+    // Actions currently in menu (in order) indexed by item hash.
+    QList<QAction *> oldActions;
+    QHash<uint, QAction *> hashToAction;
+    QSet<QAction *> unusedActions;
+    foreach (const QPointer<QAction> &actionPtr, m_clipboardItemActions) {
+        QAction *act = actionPtr.data();
+        if (act != NULL) {
+            oldActions.append(act);
+            hashToAction.insert( act->data().toUInt(), act );
+            unusedActions.insert(act);
+        }
+    }
+    m_clipboardItemActions.clear();
+
+    int j = 0;
+    for ( int i = 0; i < items.size(); ++i ) {
+        const ClipboardItem &item = *items[i];
+
+        // Skip old actions which were already moved.
+        while ( j < oldActions.size() && !unusedActions.contains(oldActions[j]) )
+            ++j;
+
+        QAction *act = hashToAction.take( item.dataHash() );
+        if (act != NULL)
+            unusedActions.remove(act);
+
+        if ( act != NULL && j < oldActions.size() && act == oldActions[j] ) {
+            // Action is already at right position.
+            ++j;
+        } else {
+            if (act == NULL)
+                act = createClipboardItemAction(item, showImages);
+            QAction *before = j < oldActions.size() ? oldActions[j]
+                                                    : m_clipboardItemActionsSeparator.data();
+            insertAction(before, act);
+        }
 
-    // Add number key hint.
-    if (i < 10)
-        act->setText( act->text().prepend(QString("&%1. ").arg(i)) );
+        m_clipboardItemActions.append(act);
 
-    QString tooltip = item.data(contentType::notes).toString();
-    if ( !tooltip.isEmpty() ) {
-        act->setToolTip(tooltip);
-        act->setProperty(propertyHasToolTip, true);
-    }
+        setClipboardItemActionText(act, i);
 
-    // Menu item icon from image.
-    if (showImages) {
-        QStringList formats = item.data(contentType::formats).toStringList();
-        int i = 0;
-        for ( ; i < formats.size(); ++i ) {
-            if (formats[i].startsWith("image/"))
-                break;
-        }
-        if (i < formats.size()) {
-            QString &format = formats[i];
-            QPixmap pix;
-            pix.loadFromData( item.data()->data(format), format.toLatin1().data() );
-            const int iconSize = 24;
-            int x = 0;
-            int y = 0;
-            if (pix.width() > pix.height()) {
-                pix = pix.scaledToHeight(iconSize);
-                x = (pix.width() - iconSize) / 2;
-            } else {
-                pix = pix.scaledToWidth(iconSize);
-                y = (pix.height() - iconSize) / 2;
-            }
-            pix = pix.copy(x, y, iconSize, iconSize);
-            act->setIcon(pix);
-        }
+        if (i == currentRow)
+            setActiveAction(act);
     }
 
-    connect(act, SIGNAL(triggered()), this, SLOT(onClipboardItemActionTriggered()));
-
-    if (isCurrent)
-        setActiveAction(act);
+    // Remove actions for items no longer in menu.
+    foreach (QAction *act, unusedActions) {
+        removeAction(act);
+        delete act;
+    }
 }
 
 void TrayMenu::addCustomAction(QAction *action)
@@ -192,7 +245,9 @@ void TrayMenu::addCustomAction(QAction *action)
 
 void TrayMenu::clearClipboardItemActions()
 {
-    removeAllActions(&m_clipboardItemActions, this);
+    foreach (const QPointer<QAction> &actionPtr, m_clipboardItemActions)
+        delete actionPtr.data();
+    m_clipboardItemActions.clear();
 }
 
 void TrayMenu::clearCustomActions()
@@ -225,6 +280,22 @@ void TrayMenu::paintEvent(QPaintEvent *event)
     }
 }
 
+void TrayMenu::changeEvent(QEvent *event)
+{
+    // Cached elided texts depend on font.
+    if ( event->type() == QEvent::FontChange || event->type() == QEvent::StyleChange ) {
+        for ( int i = 0; i < m_clipboardItemActions.size(); ++i ) {
+            QAction *act = m_clipboardItemActions[i].data();
+            if (act != NULL) {
+                updateElidedText(act, *this);
+                setClipboardItemActionText(act, i);
+            }
+        }
+    }
+
+    QMenu::changeEvent(event);
+}
+
 void TrayMenu::keyPressEvent(QKeyEvent *event)
 {
     int k = event->key();
@@ -286,6 +357,33 @@ void TrayMenu::resetSeparators()
         m_clipboardItemActionsSeparator = insertSeparator(m_customActionsSeparator);
 }
 
+QAction *TrayMenu::createClipboardItemAction(const ClipboardItem &item, bool showImages)
+{
+    const QString text = item.text();
+    QAction *act = new QAction(text, this);
+    act->setWhatsThis(text);
+    act->setData( QVariant(item.dataHash()) );
+
+    updateElidedText(act, *this);
+
+    QString tooltip = item.data(contentType::notes).toString();
+    if ( !tooltip.isEmpty() ) {
+        act->setToolTip(tooltip);
+        act->setProperty(propertyHasToolTip, true);
+    }
+
+    // Menu item icon from image.
+    if (showImages) {
+        const QPixmap pix = iconForItem(item);
+        if ( !pix.isNull() )
+            act->setIcon(pix);
+    }
+
+    connect(act, SIGNAL(triggered()), this, SLOT(onClipboardItemActionTriggered()));
+
+    return act;
+}
+
 void TrayMenu::onClipboardItemActionTriggered()
 {
     QAction *act = qobject_cast<QAction *>(sender());
@@ -36,16 +36,21 @@ public:
     void toggle();
 
     /**
-     * Add clipboard item action with number key hint.
+     * Update clipboard item actions (with number key hints) to show given @a items.
      *
-     * Triggering this action emits clipboardItemActionTriggered() signal.
+     * Actions are cached by item data hash so only actions for new items are
+     * created (text elided and image icon scaled) and only actions for items no
+     * longer in the list are removed.
+     *
+     * Triggering an action emits clipboardItemActionTriggered() signal.
      */
-    void addClipboardItemAction(const ClipboardItem &item, bool showImages, bool isCurrent);
+    void setClipboardItemActions(const QList<const ClipboardItem *> &items, bool showImages,
+                                 int currentRow);
 
     /** Add custom action. */
     void addCustomAction(QAction *action);
 
-    /** Clear clipboard item actions. */
+    /** Remove and delete clipboard item actions (this also clears the cache). */
     void clearClipboardItemActions();
 
     /** Clear custom actions. */
@@ -57,6 +62,9 @@ public:
 protected:
     void paintEvent(QPaintEvent *event);
 
+    /** Elide texts of cached clipboard item actions again if font or style changes. */
+    void changeEvent(QEvent *event);
+
 signals:
     /** Emitted if numbered action triggered. */
     void clipboardItemActionTriggered(uint clipboardItemHash);
@@ -72,10 +80,14 @@ protected:
 private:
     void resetSeparators();
 
+    /** Create action with elided text, tooltip and icon for clipboard @a item. */
+    QAction *createClipboardItemAction(const ClipboardItem &item, bool showImages);
+
     QPointer<QAction> m_clipboardItemActionsSeparator;
     QPointer<QAction> m_customActionsSeparator;
     QList<QPointer<QAction> > m_clipboardItemActions;
     QList<QPointer<QAction> > m_customActions;
+    bool m_showImages;
 
     QTimer m_timerShowTooltip;
 };
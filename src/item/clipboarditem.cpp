@@ -29,9 +29,38 @@
 #include <QStringList>
 #include <QVariant>
 
+namespace {
+
+/**
+ * Return data with all formats stored as bytes (deletes @a data).
+ *
+ * Text set using QMimeData::setText() would be otherwise converted to a new
+ * UTF-8 copy each time it's read (e.g. for item snapshot).
+ */
+QMimeData *storeAsBytes(QMimeData *data)
+{
+    QMimeData *newData = new QMimeData;
+    foreach ( const QString &mime, data->formats() )
+        newData->setData( mime, data->data(mime) );
+    delete data;
+    return newData;
+}
+
+} // namespace
+
+QByteArray ClipboardItemSnapshot::value(const QString &mime) const
+{
+    if (mime == "?")
+        return formats.join("\n").toUtf8() + '\n';
+
+    const int i = formats.indexOf(mime);
+    return i != -1 ? values[i] : QByteArray();
+}
+
 ClipboardItem::ClipboardItem()
     : m_data(new QMimeData)
     , m_hash(0)
+    , m_snapshot()
 {
 }
 
@@ -57,11 +86,28 @@ void ClipboardItem::clear()
 }
 
 void ClipboardItem::setData(QMimeData *data)
+{
+    Q_ASSERT(data != NULL);
+    delete m_data;
+    m_data = storeAsBytes(data);
+    updateDataHash();
+}
+
+void ClipboardItem::setData(QMimeData *data, unsigned int dataHash)
 {
     Q_ASSERT(data != NULL);
     delete m_data;
     m_data = data;
+    m_hash = dataHash;
+    m_snapshot.clear();
+}
+
+QMimeData *ClipboardItem::takeData()
+{
+    QMimeData *data = m_data;
+    m_data = new QMimeData;
     updateDataHash();
+    return data;
 }
 
 void ClipboardItem::setData(const QVariant &value)
@@ -69,7 +115,7 @@ void ClipboardItem::setData(const QVariant &value)
     // rewrite all original data, except notes, with edited text
     const QByteArray notes = m_data->data(mimeItemNotes);
     m_data->clear();
-    m_data->setText( value.toString() );
+    m_data->setData( QString("text/plain"), value.toString().toUtf8() );
     m_data->setData(mimeItemNotes, notes);
     updateDataHash();
 }
@@ -122,9 +168,23 @@ QVariant ClipboardItem::data(int role) const
 }
 
 
+ClipboardItemSnapshotPtr ClipboardItem::snapshot() const
+{
+    if ( m_snapshot.isNull() ) {
+        ClipboardItemSnapshot *snapshot = new ClipboardItemSnapshot;
+        snapshot->formats = m_data->formats();
+        foreach (const QString &mime, snapshot->formats)
+            snapshot->values.append( m_data->data(mime) );
+        m_snapshot = ClipboardItemSnapshotPtr(snapshot);
+    }
+
+    return m_snapshot;
+}
+
 void ClipboardItem::updateDataHash()
 {
     m_hash = hash(*m_data, m_data->formats());
+    m_snapshot.clear();
 }
 
 QDataStream &operator<<(QDataStream &stream, const ClipboardItem &item)
@@ -150,6 +210,7 @@ QDataStream &operator>>(QDataStream &stream, ClipboardItem &item)
     stream >> length;
     QString mime;
     QByteArray bytes;
+    QMimeData *data = new QMimeData;
     for (int i = 0; i < length; ++i) {
         stream >> mime >> bytes;
         if( !bytes.isEmpty() ) {
@@ -160,8 +221,11 @@ QDataStream &operator>>(QDataStream &stream, ClipboardItem &item)
                 break;
             }
         }
-        item.setData(mime, bytes);
+        data->setData(mime, bytes);
     }
 
+    // Set all formats at once so hash is computed only once.
+    item.setData(data);
+
     return stream;
 }
@@ -20,12 +20,31 @@
 #ifndef CLIPBOARDITEM_H
 #define CLIPBOARDITEM_H
 
-class QByteArray;
+#include <QByteArray>
+#include <QList>
+#include <QSharedPointer>
+#include <QStringList>
+
 class QDataStream;
 class QMimeData;
 class QString;
 class QVariant;
 
+/**
+ * Read-only copy of item data which can be accessed from any thread.
+ *
+ * Data are implicitly shared with the item so creating snapshot is cheap.
+ */
+struct ClipboardItemSnapshot {
+    /** Return data for MIME type (or list of formats if @a mime is "?"). */
+    QByteArray value(const QString &mime) const;
+
+    QStringList formats;
+    QList<QByteArray> values; //!< Data for each format.
+};
+
+typedef QSharedPointer<const ClipboardItemSnapshot> ClipboardItemSnapshotPtr;
+
 /**
  * Class for clipboard items in ClipboardModel.
  *
@@ -60,6 +79,15 @@ public:
      */
     void setData(QMimeData *data);
 
+    /**
+     * Set item's data with already computed hash.
+     * Item takes ownership of the @a data.
+     *
+     * Argument @a dataHash must be same as hash(*data, data->formats()).
+     * Formats should be stored as bytes (see cloneData()).
+     */
+    void setData(QMimeData *data, unsigned int dataHash);
+
     /** Set item's MIME type data. */
     void setData(const QString &mimeType, const QByteArray &data);
 
@@ -75,12 +103,25 @@ public:
     /** Return item's data. */
     const QMimeData *data() const { return m_data; }
 
+    /**
+     * Return item's data and release its ownership.
+     * Item is cleared.
+     */
+    QMimeData *takeData();
+
     /** Return hash for item's data. */
     unsigned int dataHash() const { return m_hash; }
 
     /** Return true if data are empty. */
     bool isEmpty() const;
 
+    /**
+     * Return snapshot of current data.
+     *
+     * Snapshot is created only once until data are changed.
+     */
+    ClipboardItemSnapshotPtr snapshot() const;
+
 private:
     /** Disable copying. */
     ClipboardItem(const ClipboardItem &);
@@ -90,6 +131,7 @@ private:
 
     QMimeData *m_data;
     unsigned int m_hash;
+    mutable ClipboardItemSnapshotPtr m_snapshot;
 };
 
 /**
@@ -31,7 +31,22 @@ ClipboardModel::ClipboardModel(QObject *parent)
     : QAbstractListModel(parent)
     , m_clipboardList()
     , m_max(100)
+    , m_snapshotMutex()
+    , m_snapshots()
+    , m_publishedRowCount(0)
 {
+    connect( this, SIGNAL(rowsInserted(QModelIndex,int,int)),
+             SLOT(onRowsInserted(QModelIndex,int,int)) );
+    connect( this, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+             SLOT(onRowsRemoved(QModelIndex,int,int)) );
+    connect( this, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+             SLOT(onRowsMoved(QModelIndex,int,int,QModelIndex,int)) );
+    connect( this, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+             SLOT(onDataChanged(QModelIndex,QModelIndex)) );
+    connect( this, SIGNAL(layoutChanged()),
+             SLOT(publishSnapshots()) );
+    connect( this, SIGNAL(modelReset()),
+             SLOT(publishSnapshots()) );
 }
 
 ClipboardModel::~ClipboardModel()
@@ -106,6 +121,17 @@ bool ClipboardModel::setData(const QModelIndex &index, QMimeData *value)
     return false;
 }
 
+bool ClipboardModel::setData(const QModelIndex &index, QMimeData *value, uint dataHash)
+{
+    if (index.isValid()) {
+        int row = index.row();
+        m_clipboardList[row]->setData(value, dataHash);
+        emit dataChanged(index, index);
+        return true;
+    }
+    return false;
+}
+
 ClipboardItem *ClipboardModel::append()
 {
     int rows = rowCount();
@@ -116,6 +142,26 @@ ClipboardItem *ClipboardModel::append()
     return item;
 }
 
+void ClipboardModel::insertItems(int position, const QList<QMimeData *> &dataList)
+{
+    if ( dataList.isEmpty() )
+        return;
+
+    QList<ClipboardItem *> items;
+    items.reserve( m_clipboardList.size() + dataList.size() );
+    items.append( m_clipboardList.mid(0, position) );
+    foreach (QMimeData *data, dataList) {
+        ClipboardItem *item = new ClipboardItem();
+        item->setData(data);
+        items.append(item);
+    }
+    items.append( m_clipboardList.mid(position) );
+
+    beginInsertRows(emptyIndex, position, position + dataList.size() - 1);
+    m_clipboardList = items;
+    endInsertRows();
+}
+
 bool ClipboardModel::insertRows(int position, int rows, const QModelIndex&)
 {
     ClipboardItem *item;
@@ -268,6 +314,72 @@ void ClipboardModel::sortItems(const QModelIndexList &indexList,
     }
 }
 
+int ClipboardModel::publishedRowCount() const
+{
+    QMutexLocker lock(&m_snapshotMutex);
+    return m_publishedRowCount;
+}
+
+void ClipboardModel::itemSnapshots(
+        const QVariantList &rows, QList<ClipboardItemSnapshotPtr> *snapshots) const
+{
+    snapshots->clear();
+
+    QMutexLocker lock(&m_snapshotMutex);
+    foreach (const QVariant &rowValue, rows)
+        snapshots->append( m_snapshots.value(rowValue.toInt()) );
+}
+
+void ClipboardModel::onRowsInserted(const QModelIndex &, int first, int last)
+{
+    QMutexLocker lock(&m_snapshotMutex);
+    m_snapshots.insert( first, last - first + 1, ClipboardItemSnapshotPtr() );
+    for (int row = first; row <= last; ++row)
+        m_snapshots[row] = m_clipboardList[row]->snapshot();
+    m_publishedRowCount = m_snapshots.size();
+}
+
+void ClipboardModel::onRowsRemoved(const QModelIndex &, int first, int last)
+{
+    QMutexLocker lock(&m_snapshotMutex);
+    m_snapshots.remove( first, last - first + 1 );
+    m_publishedRowCount = m_snapshots.size();
+}
+
+void ClipboardModel::onRowsMoved(
+        const QModelIndex &, int start, int end, const QModelIndex &, int destinationRow)
+{
+    QMutexLocker lock(&m_snapshotMutex);
+    const int count = end - start + 1;
+    const QVector<ClipboardItemSnapshotPtr> moved = m_snapshots.mid(start, count);
+    m_snapshots.remove(start, count);
+
+    // Destination row is index before the rows were removed.
+    const int row = destinationRow > end ? destinationRow - count : destinationRow;
+    for (int i = 0; i < count; ++i)
+        m_snapshots.insert(row + i, moved[i]);
+}
+
+void ClipboardModel::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    QMutexLocker lock(&m_snapshotMutex);
+    const int last = qMin( bottomRight.row(), m_snapshots.size() - 1 );
+    for ( int row = qMax(0, topLeft.row()); row <= last; ++row )
+        m_snapshots[row] = m_clipboardList[row]->snapshot();
+}
+
+void ClipboardModel::publishSnapshots()
+{
+    QVector<ClipboardItemSnapshotPtr> snapshots;
+    snapshots.reserve( m_clipboardList.size() );
+    foreach (const ClipboardItem *item, m_clipboardList)
+        snapshots.append( item->snapshot() );
+
+    QMutexLocker lock(&m_snapshotMutex);
+    m_snapshots.swap(snapshots);
+    m_publishedRowCount = m_snapshots.size();
+}
+
 int ClipboardModel::findItem(uint item_hash) const
 {
     for (int i = 0; i < m_clipboardList.length(); ++i) {
@@ -20,13 +20,16 @@
 #ifndef CLIPBOARDMODEL_H
 #define CLIPBOARDMODEL_H
 
+#include "item/clipboarditem.h"
+
 #include <QAbstractListModel>
 #include <QList>
+#include <QMutex>
+#include <QVariantList>
+#include <QVector>
 
 class QMimeData;
 
-class ClipboardItem;
-
 /**
  * Model containing ClipboardItem objects.
  *
@@ -79,9 +82,19 @@ public:
     /** Set data for given @a index. */
     bool setData(const QModelIndex &index, QMimeData *value);
 
+    /** Set data for given @a index with already computed hash (see ClipboardItem::setData()). */
+    bool setData(const QModelIndex &index, QMimeData *value, uint dataHash);
+
     /** Append new item to model. */
     ClipboardItem *append();
 
+    /**
+     * Insert new items with @a dataList at @a position (takes ownership of data).
+     *
+     * Unlike inserting rows one by one, rowsInserted() is emitted only once.
+     */
+    void insertItems(int position, const QList<QMimeData *> &dataList);
+
     /**
      * Set maximum number of items in model.
      *
@@ -135,14 +148,40 @@ public:
      */
     int getRowNumber(int row, bool cycle = false) const;
 
+    /** Return number of items (thread-safe). */
+    int publishedRowCount() const;
+
+    /**
+     * Return published snapshots of items in given @a rows (thread-safe).
+     *
+     * Snapshots are published whenever items change so this never waits
+     * for thread the model lives in. Snapshot is null for rows which don't exist.
+     */
+    void itemSnapshots(const QVariantList &rows, QList<ClipboardItemSnapshotPtr> *snapshots) const;
+
     /** Return clipboard item on given @a row or NULL if row doesn't exist. */
     ClipboardItem* get(int row) {
         return (row < rowCount()) ? m_clipboardList[row] : NULL;
     }
 
+private slots:
+    /** Publish snapshots of changed items (called whenever model changes). */
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onRowsMoved(const QModelIndex &sourceParent, int start, int end,
+                     const QModelIndex &destinationParent, int destinationRow);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+
+    /** Publish snapshots of all items. */
+    void publishSnapshots();
+
 private:
     QList<ClipboardItem *> m_clipboardList;
     int m_max;
+
+    mutable QMutex m_snapshotMutex;
+    QVector<ClipboardItemSnapshotPtr> m_snapshots;
+    int m_publishedRowCount;
 };
 
 /**
@@ -25,6 +25,7 @@
 #include "item/itemfactory.h"
 #include "item/itemwidget.h"
 
+#include <QElapsedTimer>
 #include <QMenu>
 #include <QListView>
 #include <QLayout>
@@ -38,6 +39,63 @@ const QSize defaultSize(0, 512);
 const QSize defaultMaximumSize(2048, 2048 * 8);
 const char propertyItemIndex[] = "CopyQ_item_index";
 const char propertyEditNotes[] = "CopyQ_edit_notes";
+const char propertyLayoutWidth[] = "CopyQ_layout_width";
+const char propertySizeCache[] = "CopyQ_size_cache";
+
+/** Maximum number of widths to remember item size for. */
+const int maxSizeCacheEntries = 8;
+
+/**
+ * Item sizes are remembered for width rounded down to multiple of this value
+ * so they can be used for similar widths.
+ */
+const int sizeCacheWidthStep = 8;
+
+/** Maximum time in milliseconds spent resizing items in background at once. */
+const int relayoutTimeSliceMs = 10;
+
+int sizeCacheWidth(int width)
+{
+    return qMax(0, width - width % sizeCacheWidthStep);
+}
+
+/**
+ * Return size of widget remembered for layout @a width (invalid if none).
+ *
+ * Sizes are kept in a list ordered from least recently used.
+ */
+QSize cachedSize(QWidget *w, int width)
+{
+    QVariantList sizes = w->property(propertySizeCache).toList();
+    for (int i = sizes.size() - 1; i >= 0; --i) {
+        const QVariantList entry = sizes[i].toList();
+        if ( entry.value(0).toInt() == width ) {
+            sizes.move(i, sizes.size() - 1);
+            w->setProperty(propertySizeCache, sizes);
+            return entry.value(1).toSize();
+        }
+    }
+
+    return QSize();
+}
+
+void rememberSize(QWidget *w, int width)
+{
+    QVariantList sizes = w->property(propertySizeCache).toList();
+    for (int i = 0; i < sizes.size(); ++i) {
+        if ( sizes[i].toList().value(0).toInt() == width ) {
+            sizes.removeAt(i);
+            break;
+        }
+    }
+
+    // Evict least recently used size.
+    if ( sizes.size() >= maxSizeCacheEntries )
+        sizes.removeFirst();
+
+    sizes.append( QVariantList() << width << w->size() );
+    w->setProperty(propertySizeCache, sizes);
+}
 
 inline void reset(QSharedPointer<ItemWidget> *ptr, ItemWidget *value = NULL)
 {
@@ -69,7 +127,13 @@ ItemDelegate::ItemDelegate(QListView *parent)
     , m_numberWidth(0)
     , m_numberPalette()
     , m_cache()
+    , m_relayoutRow(0)
+    , m_timerRelayout()
 {
+    m_timerRelayout.setSingleShot(true);
+    m_timerRelayout.setInterval(0);
+    connect( &m_timerRelayout, SIGNAL(timeout()),
+             this, SLOT(relayoutItems()) );
 }
 
 ItemDelegate::~ItemDelegate()
@@ -165,8 +229,12 @@ bool ItemDelegate::eventFilter(QObject *object, QEvent *event)
             QResizeEvent *resize = static_cast<QResizeEvent *>(event);
             ItemWidget *item = dynamic_cast<ItemWidget *>(object);
             if (item != NULL) {
-                item->widget()->resize(resize->size());
-                int i = item->widget()->property(propertyItemIndex).toInt();
+                QWidget *w = item->widget();
+                w->resize(resize->size());
+                const int width = m_maxSize.width();
+                if ( w->property(propertyLayoutWidth).toInt() == width )
+                    rememberSize( w, sizeCacheWidth(width) );
+                int i = w->property(propertyItemIndex).toInt();
                 emit rowSizeChanged(i);
                 return true;
             }
@@ -316,6 +384,7 @@ ItemWidget *ItemDelegate::cache(const QModelIndex &index)
         setIndexWidget(index, w);
     } else {
         w->widget()->setProperty(propertyItemIndex, index.row());
+        updateItemSize(w);
     }
 
     return w;
@@ -337,14 +406,9 @@ void ItemDelegate::setItemMaximumSize(const QSize &size)
 
     m_maxSize.setWidth(width);
 
-    for( int i = 0; i < m_cache.length(); ++i ) {
-        ItemWidget *w = m_cache[i].data();
-        if (w != NULL) {
-            w->widget()->setMaximumSize(m_maxSize);
-            w->widget()->setMinimumWidth(width);
-            w->updateSize();
-        }
-    }
+    // Resize visible items first (in cache()) and the rest later.
+    m_relayoutRow = 0;
+    m_timerRelayout.start();
 }
 
 void ItemDelegate::updateRowPosition(int row, const QPoint &position)
@@ -410,15 +474,53 @@ void ItemDelegate::setIndexWidget(const QModelIndex &index, ItemWidget *w)
     if (w == NULL)
         return;
 
-    w->widget()->setMaximumSize(m_maxSize);
-    w->widget()->setMinimumWidth(m_maxSize.width());
-    w->updateSize();
+    updateItemSize(w);
     w->widget()->installEventFilter(this);
     w->widget()->setProperty(propertyItemIndex, index.row());
 
     emit rowSizeChanged(index.row());
 }
 
+void ItemDelegate::updateItemSize(ItemWidget *w)
+{
+    QWidget *ww = w->widget();
+    const int width = m_maxSize.width();
+    if ( ww->property(propertyLayoutWidth).toInt() == width )
+        return;
+
+    ww->setMaximumSize( width, m_maxSize.height() );
+    ww->setMinimumWidth(width);
+    ww->setProperty(propertyLayoutWidth, width);
+
+    // Use remembered size for similar width so row size doesn't change
+    // while the widget is updated (e.g. web page is rendered in background).
+    const int cacheWidth = sizeCacheWidth(width);
+    const QSize size = cachedSize(ww, cacheWidth);
+    if ( size.isValid() )
+        ww->resize(size);
+
+    // Content of some widgets depends on width so always update them.
+    w->updateSize();
+    rememberSize(ww, cacheWidth);
+}
+
+void ItemDelegate::relayoutItems()
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    for ( ; m_relayoutRow < m_cache.size(); ++m_relayoutRow ) {
+        if ( elapsed.elapsed() > relayoutTimeSliceMs ) {
+            m_timerRelayout.start();
+            return;
+        }
+
+        ItemWidget *w = m_cache[m_relayoutRow].data();
+        if (w != NULL)
+            updateItemSize(w);
+    }
+}
+
 void ItemDelegate::invalidateCache()
 {
     for( int i = 0; i < m_cache.length(); ++i )
@@ -23,6 +23,7 @@
 #include <QItemDelegate>
 #include <QRegExp>
 #include <QSharedPointer>
+#include <QTimer>
 
 class Item;
 class ItemWidget;
@@ -38,6 +39,12 @@ class QListView;
  *
  * Before calling paint() for an index item on given index must be cached
  * using cache().
+ *
+ * If maximum item size changes only items returned by cache() (i.e. visible
+ * items) are resized immediately. Other items are resized later in small
+ * batches when application is idle. Item sizes are remembered for recently
+ * used widths (rounded to few pixels) so resizing to previously used width
+ * doesn't need to layout items again.
  */
 class ItemDelegate : public QItemDelegate
 {
@@ -91,7 +98,11 @@ class ItemDelegate : public QItemDelegate
         /** Return true only if item at index is already in cache. */
         bool hasCache(const QModelIndex &index) const;
 
-        /** Set maximum size for all items. */
+        /**
+         * Set maximum size for all items.
+         *
+         * Items are resized lazily (see cache()) or in background.
+         */
         void setItemMaximumSize(const QSize &size);
 
         /** Save edited item on return or ctrl+return. */
@@ -141,8 +152,23 @@ class ItemDelegate : public QItemDelegate
 
         QList< QSharedPointer<ItemWidget> > m_cache;
 
+        /** Next row to resize in background. */
+        int m_relayoutRow;
+        QTimer m_timerRelayout;
+
         void setIndexWidget(const QModelIndex &index, ItemWidget *w);
 
+        /**
+         * Resize item for current maximum width.
+         *
+         * Item is laid out only if no size is remembered for the width.
+         */
+        void updateItemSize(ItemWidget *w);
+
+    private slots:
+        /** Resize some items not resized yet (call again later if needed). */
+        void relayoutItems();
+
     public slots:
         // change size buffer
         void dataChanged(const QModelIndex &a, const QModelIndex &b);
@@ -35,6 +35,22 @@ namespace {
 
 const int dummyItemMaxChars = 4096;
 
+/** Maximum number of different format lists to cache in format-to-loader table. */
+const int maxFormatLoadersCacheSize = 256;
+
+bool canRender(const QStringList &loaderFormats, const QStringList &itemFormats)
+{
+    if ( loaderFormats.isEmpty() )
+        return true;
+
+    foreach (const QString &format, itemFormats) {
+        if ( loaderFormats.contains(format) )
+            return true;
+    }
+
+    return false;
+}
+
 bool priorityLessThan(const ItemLoaderInterface *lhs, const ItemLoaderInterface *rhs)
 {
     return lhs->priority() > rhs->priority();
@@ -82,6 +98,8 @@ ItemFactory *ItemFactory::instance()
 ItemFactory::ItemFactory()
     : m_loaders()
     , m_loaderChildren()
+    , m_loaderFormats()
+    , m_formatLoaders()
 {
     QDir pluginsDir( QCoreApplication::instance()->applicationDirPath() );
 #if defined(COPYQ_WS_X11)
@@ -122,13 +140,15 @@ ItemFactory::ItemFactory()
 
     if ( m_loaders.isEmpty() )
         log( QObject::tr("No plugins loaded!"), LogWarning );
+
+    updateFormatLoaders();
 }
 
-ItemWidget *ItemFactory::createItem(ItemLoaderInterface *loader,
-                                    const QModelIndex &index, QWidget *parent)
+ItemWidget *ItemFactory::createItem(ItemLoaderInterface *loader, const QModelIndex &index,
+                                    const QStringList &formats, QWidget *parent)
 {
     if (loader->isEnabled()) {
-        ItemWidget *item = loader->create(index, parent);
+        ItemWidget *item = loader->create(index, formats, parent);
         if (item != NULL) {
             QWidget *w = item->widget();
             QString notes = index.data(contentType::notes).toString();
@@ -146,8 +166,9 @@ ItemWidget *ItemFactory::createItem(ItemLoaderInterface *loader,
 
 ItemWidget *ItemFactory::createItem(const QModelIndex &index, QWidget *parent)
 {
-    foreach (ItemLoaderInterface *loader, m_loaders) {
-        ItemWidget *item = createItem(loader, index, parent);
+    const QStringList formats = index.data(contentType::formats).toStringList();
+    foreach ( ItemLoaderInterface *loader, loadersForFormats(formats) ) {
+        ItemWidget *item = createItem(loader, index, formats, parent);
         if (item != NULL)
             return item;
     }
@@ -202,6 +223,14 @@ void ItemFactory::setPluginPriority(const QStringList &pluginNames)
     }
 }
 
+void ItemFactory::updateFormatLoaders()
+{
+    m_formatLoaders.clear();
+    m_loaderFormats.clear();
+    foreach (const ItemLoaderInterface *loader, m_loaders)
+        m_loaderFormats.append( loader->formatsToRender() );
+}
+
 void ItemFactory::loaderChildDestroyed(QObject *obj)
 {
     m_loaderChildren.remove(obj);
@@ -220,6 +249,7 @@ ItemWidget *ItemFactory::otherItemLoader(const QModelIndex &index, ItemWidget *c
     const int currentIndex = m_loaders.indexOf(currentLoader);
     Q_ASSERT(currentIndex != -1);
 
+    const QStringList formats = index.data(contentType::formats).toStringList();
     const int size = m_loaders.size();
     for (int i = currentIndex + dir; i != currentIndex; i = i + dir) {
         if (i >= size)
@@ -227,10 +257,32 @@ ItemWidget *ItemFactory::otherItemLoader(const QModelIndex &index, ItemWidget *c
         else if (i < 0)
             i = size - 1;
 
-        ItemWidget *item = createItem(m_loaders[i], index, w->parentWidget());
+        ItemWidget *item = createItem(m_loaders[i], index, formats, w->parentWidget());
         if (item != NULL)
             return item;
     }
 
     return NULL;
 }
+
+const QVector<ItemLoaderInterface *> &ItemFactory::loadersForFormats(const QStringList &formats)
+{
+    const QString key = formats.join("\n");
+
+    QHash< QString, QVector<ItemLoaderInterface *> >::const_iterator it =
+            m_formatLoaders.constFind(key);
+    if ( it != m_formatLoaders.constEnd() )
+        return it.value();
+
+    if ( m_formatLoaders.size() >= maxFormatLoadersCacheSize )
+        m_formatLoaders.clear();
+
+    QVector<ItemLoaderInterface *> &loaders = m_formatLoaders[key];
+    for (int i = 0; i < m_loaders.size(); ++i) {
+        ItemLoaderInterface *loader = m_loaders[i];
+        if ( loader->isEnabled() && canRender(m_loaderFormats.value(i), formats) )
+            loaders.append(loader);
+    }
+
+    return loaders;
+}
@@ -20,7 +20,9 @@
 #ifndef ITEMFACTORY_H
 #define ITEMFACTORY_H
 
+#include <QHash>
 #include <QObject>
+#include <QStringList>
 #include <QVector>
 #include <QMap>
 
@@ -41,8 +43,8 @@ public:
 
     ItemFactory();
 
-    ItemWidget *createItem(ItemLoaderInterface *loader,
-                           const QModelIndex &index, QWidget *parent);
+    ItemWidget *createItem(ItemLoaderInterface *loader, const QModelIndex &index,
+                           const QStringList &formats, QWidget *parent);
 
     ItemWidget *createItem(const QModelIndex &index, QWidget *parent);
 
@@ -56,15 +58,30 @@ public:
 
     void setPluginPriority(const QStringList &pluginNames);
 
+    /**
+     * Rebuild table which routes items to loaders by item formats.
+     *
+     * Call this after loader priority, settings or enabled state changes.
+     */
+    void updateFormatLoaders();
+
 private slots:
     void loaderChildDestroyed(QObject *obj);
 
 private:
     ItemWidget *otherItemLoader(const QModelIndex &index, ItemWidget *current, int dir);
 
+    /** Return enabled loaders (in priority order) which can render item with given formats. */
+    const QVector<ItemLoaderInterface *> &loadersForFormats(const QStringList &formats);
+
     static ItemFactory *m_Instance;
     QVector<ItemLoaderInterface *> m_loaders;
     QMap<QObject *, ItemLoaderInterface *> m_loaderChildren;
+
+    /** Formats rendered by loader with same index in m_loaders. */
+    QVector<QStringList> m_loaderFormats;
+    /** Loaders for item formats (joined with new line). */
+    QHash< QString, QVector<ItemLoaderInterface *> > m_formatLoaders;
 };
 
 #endif // ITEMFACTORY_H
@@ -31,7 +31,7 @@ class QModelIndex;
 class QPalette;
 class QWidget;
 
-#define COPYQ_PLUGIN_ITEM_LOADER_ID "org.CopyQ.ItemPlugin.ItemLoader/1.0"
+#define COPYQ_PLUGIN_ITEM_LOADER_ID "org.CopyQ.ItemPlugin.ItemLoader/2.0"
 
 #if QT_VERSION < 0x050000
 #   define Q_PLUGIN_METADATA(x)
@@ -127,9 +127,13 @@ public:
     /**
      * Create ItemWidget instance from index data.
      *
+     * Item @a formats are passed so that loaders don't need to fetch them
+     * again from @a index.
+     *
      * @return NULL if index hasn't appropriate data
      */
-    virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const = 0;
+    virtual ItemWidget *create(const QModelIndex &index, const QStringList &formats,
+                               QWidget *parent) const = 0;
 
     /**
      * Simple ID of plugin (e.g. part of plugin file name).
@@ -156,6 +160,14 @@ public:
      */
     virtual QStringList formatsToSave() const { return QStringList(); }
 
+    /**
+     * Provide formats which can be rendered by create() (possibly configurable).
+     *
+     * Item is passed to create() only if it contains any of these formats.
+     * Empty list means that create() is called for items with any formats.
+     */
+    virtual QStringList formatsToRender() const { return QStringList(); }
+
     virtual QVariantMap applySettings() { return QVariantMap(); }
 
     virtual void loadSettings(const QVariantMap &) {}
@@ -65,6 +65,10 @@ typedef QSharedPointer<PlatformNativeInterface> PlatformPtr;
 
 /**
  * Factory method to create PlatformNativeInterface instance.
+ *
+ * Instance can be shared with other callers in the same thread so it can
+ * keep resources (e.g. connection to window system) and cache values.
+ * It must not be passed to other threads.
  */
 PlatformPtr createPlatformNativeInterface();
 
@@ -12,6 +12,14 @@ else(X11_XTest_FOUND)
                     " automatically paste to some windows!")
 endif(X11_XTest_FOUND)
 
+if(X11_Xinput_FOUND)
+    add_definitions( -DHAS_X11XINPUT2 )
+    set(copyq_LIBRARIES ${copyq_LIBRARIES} ${X11_Xinput_LIB})
+else(X11_Xinput_FOUND)
+    message(WARNING "X11 'XInput' extension library is needed to detect"
+                    " finished selection without polling!")
+endif(X11_Xinput_FOUND)
+
 add_definitions( -DCOPYQ_WS_X11 )
 
 file(GLOB copyq_SOURCES ${copyq_SOURCES}
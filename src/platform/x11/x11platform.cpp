@@ -19,10 +19,18 @@
 
 #include "x11platform.h"
 
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QThreadStorage>
+
 #include <X11/extensions/XTest.h>
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
 #include <X11/Xatom.h>
+#ifdef HAS_X11XINPUT2
+#   include <X11/extensions/XInput2.h>
+#endif
 #include <unistd.h> // usleep()
 
 namespace {
@@ -143,29 +151,271 @@ void simulateKeyPress(Display *display, Window window, unsigned int modifiers, u
 }
 #endif
 
+/**
+ * X11 error handler is global for the process but platform objects live in
+ * different threads, each with its own display connection. So the handler is
+ * installed only once and errors are ignored only for displays which asked
+ * for it; other errors are passed to previous handler.
+ */
+struct X11ErrorState {
+    X11ErrorState()
+        : mutex()
+        , previousHandler(NULL)
+        , installed(false)
+        , ignoredDisplays()
+        , failedDisplays()
+    {}
+
+    QMutex mutex;
+    XErrorHandler previousHandler;
+    bool installed;
+    QSet<Display *> ignoredDisplays;
+    QSet<Display *> failedDisplays;
+};
+
+Q_GLOBAL_STATIC(X11ErrorState, x11ErrorState)
+
+int handleX11Error(Display *display, XErrorEvent *event)
+{
+    X11ErrorState *state = x11ErrorState();
+    XErrorHandler previousHandler;
+    {
+        QMutexLocker lock(&state->mutex);
+        if ( state->ignoredDisplays.contains(display) ) {
+            state->failedDisplays.insert(display);
+            return 0;
+        }
+        previousHandler = state->previousHandler;
+    }
+
+    return previousHandler != NULL ? previousHandler(display, event) : 0;
+}
+
+/**
+ * Change event mask for a window owned by other client.
+ *
+ * The window can be destroyed at any time so errors are ignored.
+ */
+bool selectWindowInput(Display *display, Window w, long eventMask)
+{
+    X11ErrorState *state = x11ErrorState();
+    {
+        QMutexLocker lock(&state->mutex);
+        if (!state->installed) {
+            state->previousHandler = XSetErrorHandler(handleX11Error);
+            state->installed = true;
+        }
+        state->ignoredDisplays.insert(display);
+        state->failedDisplays.remove(display);
+    }
+
+    XSelectInput(display, w, eventMask);
+    XSync(display, False);
+
+    QMutexLocker lock(&state->mutex);
+    state->ignoredDisplays.remove(display);
+    return !state->failedDisplays.remove(display);
+}
+
+Q_GLOBAL_STATIC(QThreadStorage<PlatformPtr>, platformStorage)
+
 } // namespace
 
 PlatformPtr createPlatformNativeInterface()
 {
-    return PlatformPtr(new X11Platform);
+    // Display connection is expensive to open so keep one per thread.
+    QThreadStorage<PlatformPtr> *storage = platformStorage();
+    if ( !storage->hasLocalData() )
+        storage->setLocalData( PlatformPtr(new X11Platform) );
+    return storage->localData();
 }
 
 class X11PlatformPrivate
 {
 public:
+    X11PlatformPrivate()
+        : display(XOpenDisplay(NULL))
+        , atomActiveWindow(None)
+        , atomName(None)
+        , atomUTF8(None)
+        , activeWindow(None)
+        , activeWindowValid(false)
+        , title()
+        , titleValid(false)
+        , xiOpcode(-1)
+        , xiChecked(false)
+        , watchingInputRelease(false)
+        , inputReleased(false)
+    {
+        if (display == NULL)
+            return;
+
+        atomActiveWindow = XInternAtom(display, "_NET_ACTIVE_WINDOW", False);
+        atomName = XInternAtom(display, "_NET_WM_NAME", False);
+        atomUTF8 = XInternAtom(display, "UTF8_STRING", False);
+
+        // Active window changes are reported as property changes of root window.
+        XSelectInput(display, DefaultRootWindow(display), PropertyChangeMask);
+        XFlush(display);
+    }
+
+    ~X11PlatformPrivate()
+    {
+        if (display != NULL)
+            XCloseDisplay(display);
+    }
+
+    /**
+     * Invalidate cached values if related window properties changed.
+     *
+     * Only events already received are processed (no round trip to X server).
+     */
+    void processEvents()
+    {
+        const Window root = DefaultRootWindow(display);
+
+        while ( XPending(display) > 0 ) {
+            XEvent event;
+            XNextEvent(display, &event);
+
+#ifdef HAS_X11XINPUT2
+            if (event.type == GenericEvent && event.xcookie.extension == xiOpcode) {
+                if (event.xcookie.evtype == XI_RawButtonRelease
+                    || event.xcookie.evtype == XI_RawKeyRelease)
+                {
+                    inputReleased = true;
+                }
+                continue;
+            }
+#endif
+
+            if (event.type != PropertyNotify)
+                continue;
+
+            const XPropertyEvent &e = event.xproperty;
+            if (e.window == root && e.atom == atomActiveWindow)
+                activeWindowValid = false;
+            else if (e.window == activeWindow && e.atom == atomName)
+                titleValid = false;
+        }
+    }
+
+    Window fetchActiveWindow()
+    {
+        X11WindowProperty property(display, DefaultRootWindow(display), atomActiveWindow, 0l, 1l,
+                                   XA_WINDOW);
+
+        if ( property.isValid() && property.type == XA_WINDOW && property.format == 32 &&
+             property.len == 1) {
+                return *reinterpret_cast<Window *>(property.data);
+        }
+
+        return None;
+    }
+
+    QString fetchWindowTitle(Window w)
+    {
+        X11WindowProperty property(display, w, atomName, 0, (~0L), atomUTF8);
+        if ( property.isValid() ) {
+            QByteArray result(reinterpret_cast<const char *>(property.data), property.len);
+            return QString::fromUtf8(result);
+        }
+
+        return QString();
+    }
+
+    void updateActiveWindow()
+    {
+        const Window w = fetchActiveWindow();
+        if (w != activeWindow) {
+            if (activeWindow != None)
+                selectWindowInput(display, activeWindow, NoEventMask);
+
+            // Watch for title changes; window can be already destroyed.
+            activeWindow = w;
+            if ( activeWindow != None && !selectWindowInput(display, activeWindow, PropertyChangeMask) )
+                activeWindow = None;
+
+            titleValid = false;
+        }
+
+        activeWindowValid = true;
+    }
+
+    /**
+     * Select raw mouse button and key release events on root window.
+     *
+     * Raw events are received even if other client grabs the input
+     * (requires XInput 2.1).
+     */
+    bool selectInputRelease(bool enable)
+    {
+#ifdef HAS_X11XINPUT2
+        if (!xiChecked) {
+            xiChecked = true;
+            int event, error;
+            int major = 2;
+            int minor = 1;
+            if ( !XQueryExtension(display, "XInputExtension", &xiOpcode, &event, &error)
+                 || XIQueryVersion(display, &major, &minor) != Success
+                 || major * 100 + minor < 201 )
+            {
+                xiOpcode = -1;
+            }
+        }
+
+        if (xiOpcode == -1)
+            return false;
+
+        unsigned char bits[XIMaskLen(XI_LASTEVENT)] = {0};
+        if (enable) {
+            XISetMask(bits, XI_RawButtonRelease);
+            XISetMask(bits, XI_RawKeyRelease);
+        }
+
+        XIEventMask mask;
+        mask.deviceid = XIAllMasterDevices;
+        mask.mask_len = sizeof(bits);
+        mask.mask = bits;
+        XISelectEvents(display, DefaultRootWindow(display), &mask, 1);
+        XFlush(display);
+
+        return true;
+#else
+        Q_UNUSED(enable);
+        return false;
+#endif
+    }
+
     Display *display;
+
+    Atom atomActiveWindow;
+    Atom atomName;
+    Atom atomUTF8;
+
+    /** Cached active window (valid only if activeWindowValid is true). */
+    Window activeWindow;
+    bool activeWindowValid;
+
+    /** Cached title of active window (valid only if titleValid is true). */
+    QString title;
+    bool titleValid;
+
+    /** XInput extension opcode (-1 if XInput 2.1 is not available). */
+    int xiOpcode;
+    bool xiChecked;
+
+    bool watchingInputRelease;
+    bool inputReleased;
 };
 
 X11Platform::X11Platform()
     : d(new X11PlatformPrivate)
 {
-    d->display = XOpenDisplay(NULL);
 }
 
 X11Platform::~X11Platform()
 {
-    if (d->display != NULL)
-        XCloseDisplay(d->display);
     delete d;
 }
 
@@ -174,19 +424,11 @@ WId X11Platform::getCurrentWindow()
     if (d->display == NULL)
         return 0L;
 
-    XSync(d->display, False);
+    d->processEvents();
+    if (!d->activeWindowValid)
+        d->updateActiveWindow();
 
-    static Atom atomWindow = XInternAtom(d->display, "_NET_ACTIVE_WINDOW", true);
-
-    X11WindowProperty property(d->display, DefaultRootWindow(d->display), atomWindow, 0l, 1l,
-                               XA_WINDOW);
-
-    if ( property.isValid() && property.type == XA_WINDOW && property.format == 32 &&
-         property.len == 1) {
-            return *reinterpret_cast<Window *>(property.data);
-    }
-
-    return 0L;
+    return d->activeWindow;
 }
 
 QString X11Platform::getWindowTitle(WId wid)
@@ -194,16 +436,16 @@ QString X11Platform::getWindowTitle(WId wid)
     if (d->display == NULL || wid == 0L)
         return QString();
 
-    static Atom atomName = XInternAtom(d->display, "_NET_WM_NAME", false);
-    static Atom atomUTF8 = XInternAtom(d->display, "UTF8_STRING", false);
+    d->processEvents();
+    if (!d->activeWindowValid || d->activeWindow != wid)
+        return d->fetchWindowTitle(wid);
 
-    X11WindowProperty property(d->display, wid, atomName, 0, (~0L), atomUTF8);
-    if ( property.isValid() ) {
-        QByteArray result(reinterpret_cast<const char *>(property.data), property.len);
-        return QString::fromUtf8(result);
+    if (!d->titleValid) {
+        d->title = d->fetchWindowTitle(wid);
+        d->titleValid = true;
     }
 
-    return QString();
+    return d->title;
 }
 
 void X11Platform::raiseWindow(WId wid)
@@ -255,6 +497,47 @@ WId X11Platform::getPasteWindow()
     return getCurrentWindow();
 }
 
+int X11Platform::connectionNumber()
+{
+    return d->display == NULL ? -1 : ConnectionNumber(d->display);
+}
+
+bool X11Platform::startWatchingInputRelease()
+{
+    if (d->display == NULL)
+        return false;
+
+    if (!d->watchingInputRelease) {
+        if ( !d->selectInputRelease(true) )
+            return false;
+        d->watchingInputRelease = true;
+        d->inputReleased = false;
+    }
+
+    return true;
+}
+
+void X11Platform::stopWatchingInputRelease()
+{
+    if (!d->watchingInputRelease)
+        return;
+
+    d->selectInputRelease(false);
+    d->watchingInputRelease = false;
+    d->inputReleased = false;
+}
+
+bool X11Platform::hasInputReleased()
+{
+    if (d->display == NULL)
+        return false;
+
+    d->processEvents();
+    const bool released = d->inputReleased;
+    d->inputReleased = false;
+    return released;
+}
+
 bool X11Platform::isSelecting()
 {
     // If mouse button or shift is pressed then assume that user is selecting text.
@@ -270,3 +553,13 @@ bool X11Platform::isSelecting()
 
     return event.xbutton.state & (Button1Mask | ShiftMask);
 }
+
+WId X11Platform::selectionOwner(bool primarySelection)
+{
+    if (d->display == NULL)
+        return 0L;
+
+    const Atom selection = primarySelection ? XA_PRIMARY
+                                            : XInternAtom(d->display, "CLIPBOARD", False);
+    return XGetSelectionOwner(d->display, selection);
+}
@@ -41,8 +41,38 @@ public:
 
     WId getPasteWindow();
 
+    /**
+     * Return true if mouse button or shift is pressed (user is probably selecting text).
+     */
     bool isSelecting();
 
+    /** Return owner of primary selection or clipboard (0 if there is no owner). */
+    WId selectionOwner(bool primarySelection);
+
+    /**
+     * Return file descriptor of connection to X server (-1 if not connected).
+     *
+     * Socket becomes readable if there are new events for hasInputReleased().
+     */
+    int connectionNumber();
+
+    /**
+     * Start listening for mouse button and key release events.
+     *
+     * Returns false if events are not available (isSelecting() needs to be
+     * polled instead).
+     */
+    bool startWatchingInputRelease();
+
+    /** Stop listening for mouse button and key release events. */
+    void stopWatchingInputRelease();
+
+    /**
+     * Process received events and return true if any mouse button or key was
+     * released since last call.
+     */
+    bool hasInputReleased();
+
 private:
     X11PlatformPrivate *d;
 };
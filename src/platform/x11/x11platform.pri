@@ -1,10 +1,15 @@
 DEFINES += COPYQ_WS_X11 HAS_X11TEST
 LIBS    += -lX11 -lXfixes -lXtst
 SOURCES += platform/x11/x11platform.cpp \
+           platform/x11/x11selectionreader.cpp \
            ../qxt/qxtglobalshortcut_x11.cpp
 USE_QXT = 1
+greaterThan(QT_MAJOR_VERSION, 4) { QT += gui-private }
 
-greaterThan(QT_MAJOR_VERSION, 4) {
-    QT += gui-private
+# XInput 2 is optional; build with "CONFIG+=no_xinput2" to disable it.
+!no_xinput2:packagesExist(xi) {
+    DEFINES += HAS_X11XINPUT2
+    LIBS    += -lXi
+} else {
+    warning("X11 'XInput' extension library is needed to detect finished selection without polling!")
 }
-
@@ -0,0 +1,367 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "x11selectionreader.h"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <sys/select.h>
+
+namespace {
+
+/// Maximum time (in ms) to wait for a response from clipboard owner.
+const int timeoutMs = 5000;
+
+/// Interval (in ms) for checking if transfer was aborted.
+const int abortCheckIntervalMs = 100;
+
+/// Number of 32-bit units to read from a property at once.
+const long propertyChunkLength = 0x10000;
+
+/// Number of bytes to read from temporary file at once.
+const qint64 fileChunkSize = 0x100000;
+
+/**
+ * Return X11 targets to request for MIME @a format (in order of preference).
+ *
+ * Owners usually provide plain text only as UTF8_STRING.
+ */
+QStringList targetsForFormat(const QString &format)
+{
+    QStringList targets;
+    if (format == "text/plain")
+        targets << "UTF8_STRING" << "text/plain;charset=utf-8";
+    targets << format;
+    return targets;
+}
+
+Atom selectionAtom(Display *display, bool primarySelection)
+{
+    return primarySelection ? XA_PRIMARY : XInternAtom(display, "CLIPBOARD", False);
+}
+
+struct PropertyMatch {
+    Window window;
+    Atom property;
+    /// Serial of request for next chunk; older property changes are stale.
+    unsigned long serial;
+};
+
+Bool isSelectionNotify(Display *, XEvent *event, XPointer arg)
+{
+    const PropertyMatch *match = reinterpret_cast<const PropertyMatch *>(arg);
+    return event->type == SelectionNotify
+            && event->xselection.requestor == match->window;
+}
+
+Bool isPropertyNotify(Display *, XEvent *event, XPointer arg)
+{
+    const PropertyMatch *match = reinterpret_cast<const PropertyMatch *>(arg);
+    return event->type == PropertyNotify
+            && event->xproperty.window == match->window
+            && event->xproperty.atom == match->property;
+}
+
+/**
+ * Return true if property was changed by owner after the next chunk was requested.
+ *
+ * Owner sets the property (e.g. to INCR) before sending SelectionNotify so
+ * events preceding the request must be skipped, otherwise an empty chunk
+ * would be read and transfer would end prematurely.
+ */
+bool isNewPropertyValue(const XEvent &event, const PropertyMatch &match)
+{
+    return event.xproperty.state == PropertyNewValue
+            && static_cast<long>(event.xproperty.serial - match.serial) >= 0;
+}
+
+/**
+ * Return property data as bytes.
+ *
+ * Xlib returns 32-bit items as array of longs (which can be 64-bit).
+ */
+QByteArray propertyBytes(int format, const unsigned char *data, unsigned long items)
+{
+    if (format == 32 && sizeof(long) != 4) {
+        QByteArray bytes;
+        bytes.reserve(items * 4);
+        const long *values = reinterpret_cast<const long *>(data);
+        for (unsigned long i = 0; i < items; ++i) {
+            const quint32 value = static_cast<quint32>(values[i]);
+            bytes.append( reinterpret_cast<const char *>(&value), 4 );
+        }
+        return bytes;
+    }
+
+    return QByteArray( reinterpret_cast<const char *>(data), items * (format / 8) );
+}
+
+} // namespace
+
+X11SelectionReader::X11SelectionReader(
+        bool primarySelection, const QString &format, qint64 maxSize, QObject *parent)
+    : QThread(parent)
+    , m_primarySelection(primarySelection)
+    , m_format(format)
+    , m_maxSize(maxSize)
+    , m_abort(0)
+    , m_file()
+    , m_owner(None)
+    , m_expectedTimestamp(CurrentTime)
+    , m_timestamp(CurrentTime)
+    , m_outdated(false)
+    , m_valid(false)
+    , m_targetUnavailable(false)
+    , m_error()
+{
+}
+
+X11SelectionReader::~X11SelectionReader()
+{
+    abort();
+    wait();
+}
+
+void X11SelectionReader::abort()
+{
+    m_abort.fetchAndStoreOrdered(1);
+}
+
+void X11SelectionReader::setExpectedContent(unsigned long owner, unsigned long timestamp)
+{
+    m_owner = owner;
+    m_expectedTimestamp = timestamp;
+}
+
+QByteArray X11SelectionReader::data()
+{
+    if ( !m_valid || !m_file.seek(0) )
+        return QByteArray();
+
+    // Check size before allocating and read directly into the result.
+    const qint64 size = m_file.size();
+    if (size > m_maxSize)
+        return QByteArray();
+
+    QByteArray bytes;
+    bytes.resize( static_cast<int>(size) );
+    for (qint64 pos = 0; pos < size; ) {
+        const qint64 read = m_file.read( bytes.data() + pos, qMin(fileChunkSize, size - pos) );
+        if (read <= 0)
+            return QByteArray();
+        pos += read;
+    }
+
+    return bytes;
+}
+
+void X11SelectionReader::run()
+{
+    Display *display = XOpenDisplay(NULL);
+    if (display == NULL) {
+        m_error = "Cannot connect to X server";
+        return;
+    }
+
+    const Window window = XCreateSimpleWindow(
+                display, DefaultRootWindow(display), 0, 0, 1, 1, 0, 0, 0);
+    XSelectInput(display, window, PropertyChangeMask);
+
+    if ( !m_file.open() ) {
+        m_error = "Cannot create temporary file";
+    } else if ( checkContent(display, window) ) {
+        foreach ( const QString &target, targetsForFormat(m_format) ) {
+            m_valid = transfer(display, window, target, &m_file);
+            if (m_valid || !m_targetUnavailable)
+                break;
+        }
+        m_valid = m_valid && m_file.flush();
+    }
+
+    XDestroyWindow(display, window);
+    XCloseDisplay(display);
+}
+
+bool X11SelectionReader::isAborted()
+{
+    return m_abort.fetchAndAddOrdered(0) != 0;
+}
+
+bool X11SelectionReader::checkContent(Display *display, Window window)
+{
+    if ( m_owner != None
+         && XGetSelectionOwner(display, selectionAtom(display, m_primarySelection)) != m_owner )
+    {
+        m_error = "Clipboard owner changed";
+        m_outdated = true;
+        return false;
+    }
+
+    // Owner can keep same window for new content so compare timestamps too.
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    if ( transfer(display, window, "TIMESTAMP", &buffer) ) {
+        quint32 timestamp = 0;
+        if ( buffer.size() >= static_cast<qint64>(sizeof(timestamp)) )
+            memcpy( &timestamp, buffer.data().constData(), sizeof(timestamp) );
+        m_timestamp = timestamp;
+    } else if (!m_targetUnavailable) {
+        // Owner is not responding or transfer was aborted.
+        return false;
+    }
+
+    if ( m_expectedTimestamp != CurrentTime && m_timestamp != CurrentTime
+         && m_timestamp != m_expectedTimestamp )
+    {
+        m_error = "Clipboard content changed";
+        m_outdated = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool X11SelectionReader::transfer(
+        Display *display, Window window, const QString &targetName, QIODevice *output)
+{
+    m_targetUnavailable = false;
+
+    const Atom selection = selectionAtom(display, m_primarySelection);
+    const Atom target = XInternAtom(display, targetName.toLatin1().constData(), False);
+    const Atom property = XInternAtom(display, "COPYQ_SELECTION_DATA", False);
+    const Atom atomIncr = XInternAtom(display, "INCR", False);
+
+    PropertyMatch match;
+    match.window = window;
+    match.property = property;
+    match.serial = 0;
+
+    XConvertSelection(display, selection, target, property, window, CurrentTime);
+    XFlush(display);
+
+    const int fd = ConnectionNumber(display);
+    bool incremental = false;
+    bool waitForSelection = true;
+    qint64 size = 0;
+
+    for (;;) {
+        // Wait for owner to send data (with a timeout without any progress).
+        XEvent event;
+        QElapsedTimer t;
+        t.start();
+        for (;;) {
+            if ( XCheckIfEvent(display, &event, waitForSelection ? isSelectionNotify : isPropertyNotify,
+                               reinterpret_cast<XPointer>(&match)) )
+            {
+                if ( waitForSelection || isNewPropertyValue(event, match) )
+                    break;
+                continue;
+            }
+
+            if ( isAborted() ) {
+                m_error = "Aborted";
+                return false;
+            }
+
+            if (t.elapsed() > timeoutMs) {
+                m_error = "Clipboard owner is not responding";
+                return false;
+            }
+
+            fd_set fds;
+            FD_ZERO(&fds);
+            FD_SET(fd, &fds);
+            timeval timeout;
+            timeout.tv_sec = 0;
+            timeout.tv_usec = abortCheckIntervalMs * 1000;
+            select(fd + 1, &fds, NULL, NULL, &timeout);
+        }
+
+        if (waitForSelection) {
+            waitForSelection = false;
+            if (event.xselection.property == None) {
+                m_error = "Format is not available";
+                m_targetUnavailable = true;
+                return false;
+            }
+        }
+
+        // Read property in chunks.
+        bool startIncremental = false;
+        qint64 chunkSize = 0;
+        long offset = 0;
+        for (;;) {
+            Atom type;
+            int format;
+            unsigned long items;
+            unsigned long remain;
+            unsigned char *data = NULL;
+            if ( XGetWindowProperty(display, window, property, offset, propertyChunkLength,
+                                    False, AnyPropertyType, &type, &format,
+                                    &items, &remain, &data) != Success )
+            {
+                m_error = "Cannot read window property";
+                return false;
+            }
+
+            if (type == atomIncr && !incremental) {
+                XFree(data);
+                incremental = startIncremental = true;
+                break;
+            }
+
+            if (data != NULL) {
+                const QByteArray bytes = propertyBytes(format, data, items);
+                XFree(data);
+
+                size += bytes.size();
+                if (size > m_maxSize) {
+                    m_error = "Data are too large";
+                    return false;
+                }
+
+                if ( output->write(bytes) != bytes.size() ) {
+                    m_error = "Cannot write to temporary file";
+                    return false;
+                }
+
+                chunkSize += bytes.size();
+                offset += bytes.size() / 4;
+            }
+
+            if (remain == 0)
+                break;
+        }
+
+        // Deleting the property requests next chunk in incremental transfer.
+        match.serial = NextRequest(display);
+        XDeleteProperty(display, window, property);
+        XFlush(display);
+
+        // Transfer is complete after non-incremental data or empty chunk.
+        if ( !startIncremental && (!incremental || chunkSize == 0) )
+            return true;
+    }
+}
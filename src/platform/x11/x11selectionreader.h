@@ -0,0 +1,113 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef X11SELECTIONREADER_H
+#define X11SELECTIONREADER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QString>
+#include <QTemporaryFile>
+#include <QThread>
+
+class QIODevice;
+struct _XDisplay;
+
+/**
+ * Retrieves single format of X11 clipboard or primary selection in separate thread.
+ *
+ * Uses its own connection to X server so the calling thread is not blocked
+ * by slow clipboard owner or while large data are transferred (using INCR
+ * protocol). Data are stored in a temporary file instead of memory until the
+ * transfer is finished.
+ *
+ * Emits finished() after transfer ends (successfully or not).
+ */
+class X11SelectionReader : public QThread
+{
+public:
+    X11SelectionReader(
+            bool primarySelection, //!< If true, read primary selection, otherwise clipboard.
+            const QString &format, //!< MIME type to retrieve (X11 target name).
+            qint64 maxSize, //!< Maximum size of data (in bytes).
+            QObject *parent = NULL
+            );
+
+    /** Abort transfer and wait for thread to finish. */
+    ~X11SelectionReader();
+
+    /** Abort transfer (thread finishes shortly after). */
+    void abort();
+
+    /**
+     * Fail if selection @a owner window or @a timestamp of current content
+     * differs (zero values are not checked). Call before the thread is started.
+     */
+    void setExpectedContent(unsigned long owner, unsigned long timestamp);
+
+    /**
+     * Return true if transfer failed because selection owner or timestamp
+     * differs from expected (call after the thread finished).
+     */
+    bool isOutdated() const { return m_outdated; }
+
+    /** Return timestamp of the content (zero if unknown; call after the thread finished). */
+    unsigned long timestamp() const { return m_timestamp; }
+
+    /** Return requested format. */
+    const QString &format() const { return m_format; }
+
+    /** Return true if data were successfully retrieved (call after the thread finished). */
+    bool isValid() const { return m_valid; }
+
+    /** Return reason of failed transfer. */
+    const QString &errorString() const { return m_error; }
+
+    /** Return retrieved data (call after the thread finished). */
+    QByteArray data();
+
+protected:
+    void run();
+
+private:
+    bool isAborted();
+
+    /** Retrieve timestamp of content and check it and the owner. */
+    bool checkContent(_XDisplay *display, unsigned long window);
+
+    /** Retrieve selection converted to @a target (X11 atom name) to @a output. */
+    bool transfer(_XDisplay *display, unsigned long window, const QString &target,
+                  QIODevice *output);
+
+    bool m_primarySelection;
+    QString m_format;
+    qint64 m_maxSize;
+    QAtomicInt m_abort;
+    QTemporaryFile m_file;
+    unsigned long m_owner;
+    unsigned long m_expectedTimestamp;
+    unsigned long m_timestamp;
+    bool m_outdated;
+    bool m_valid;
+    /** Owner refused to convert selection to last requested target. */
+    bool m_targetUnavailable;
+    QString m_error;
+};
+
+#endif // X11SELECTIONREADER_H
@@ -18,6 +18,7 @@
 */
 
 #include "scriptable.h"
+#include "scriptenginepool.h"
 
 #include "common/client_server.h"
 #include "gui/configurationmanager.h"
@@ -197,10 +198,16 @@ QList<CommandHelp> commandHelp()
                        Scriptable::tr("Set option value."))
            .addArg(Scriptable::tr("OPTION"))
            .addArg(Scriptable::tr("VALUE"))
+        << CommandHelp("stats",
+                       Scriptable::tr("Print performance statistics (including script cache hit rate)."))
         << CommandHelp()
         << CommandHelp("eval, -e",
                        Scriptable::tr("Evaluate ECMAScript program."))
            .addArg("[" + Scriptable::tr("SCRIPT") + "]")
+        << CommandHelp("batch",
+                       Scriptable::tr("Run commands from FILE or standard input (one command per line)\n"
+                                      "using single connection to server."))
+           .addArg("[" + Scriptable::tr("FILE") + "]")
         << CommandHelp("session, -s, --session",
                        Scriptable::tr("\nStarts or connects to application instance with given session name."))
            .addArg(Scriptable::tr("SESSION"))
@@ -264,29 +271,31 @@ Scriptable::Scriptable(ScriptableProxy *proxy, QObject *parent)
     , m_currentTab()
     , m_inputSeparator("\n")
     , m_currentPath()
+    , m_programs()
 {
 }
 
 void Scriptable::initEngine(QScriptEngine *eng, const QString &currentPath)
 {
     m_engine = eng;
-    QScriptEngine::QObjectWrapOptions opts =
-              QScriptEngine::ExcludeChildObjects
-            | QScriptEngine::SkipMethodsInEnumeration
-            | QScriptEngine::ExcludeSuperClassMethods
-            | QScriptEngine::ExcludeSuperClassProperties
-            | QScriptEngine::ExcludeSuperClassContents
-            | QScriptEngine::ExcludeDeleteLater;
-    QScriptValue obj = eng->newQObject(this, QScriptEngine::QtOwnership, opts);
-    eng->setGlobalObject(obj);
     eng->setProcessEventsInterval(1000);
 
     m_baClass = new ByteArrayClass(eng);
-    obj.setProperty( "ByteArray", m_baClass->constructor() );
+    setGlobalObject();
 
     setCurrentPath(currentPath);
 }
 
+void Scriptable::reset(const QString &currentPath)
+{
+    m_currentTab.clear();
+    m_inputSeparator = QString("\n");
+    setCurrentPath(currentPath);
+
+    m_engine->clearExceptions();
+    setGlobalObject();
+}
+
 QScriptValue Scriptable::newByteArray(const QByteArray &bytes)
 {
     return m_baClass->newInstance(bytes);
@@ -635,7 +644,7 @@ void Scriptable::insert()
 void Scriptable::remove()
 {
     QScriptValue value;
-    QList<int> rows;
+    QVariantList rows;
 
     for ( int i = 0; i < argumentCount(); ++i ) {
         value = argument(i);
@@ -649,11 +658,7 @@ void Scriptable::remove()
 
     int tab = currentTab();
 
-    qSort( rows.begin(), rows.end(), qGreater<int>() );
-
-    foreach (int row, rows)
-        m_proxy->removeRow(tab, row);
-
+    m_proxy->removeRows(tab, rows);
     m_proxy->delayedSaveItems(tab, 1000);
 }
 
@@ -664,13 +669,23 @@ void Scriptable::edit()
     QString text;
     int row;
 
+    // Fetch all items at once.
+    QVariantList rows;
     const int len = argumentCount();
+    for ( int i = 0; i < len; ++i ) {
+        if ( toInt(argument(i), row) && row >= 0 )
+            rows.append(row);
+    }
+    const QVariantList items = rows.isEmpty()
+            ? QVariantList() : m_proxy->itemsData(tab, rows, defaultMime);
+
+    int itemIndex = 0;
     for ( int i = 0; i < len; ++i ) {
         value = argument(i);
         if (i > 0)
             text.append( getInputSeparator() );
         if ( toInt(value, row) ) {
-            text.append( row >= 0 ? m_proxy->itemData(tab, row, defaultMime)
+            text.append( row >= 0 ? items.value(itemIndex++).toByteArray()
                                   : QString::fromUtf8(m_proxy->getClipboardData(defaultMime)) );
         } else {
             text.append( toString(value) );
@@ -695,23 +710,51 @@ QScriptValue Scriptable::read()
     QScriptValue value;
     QString sep = getInputSeparator();
 
-    bool used = false;
+    // Collect rows and their MIME types first so items can be fetched at once.
+    QList<int> rows;
+    QStringList mimes;
     for ( int i = 0; i < argumentCount(); ++i ) {
         value = argument(i);
         int row;
         if ( toInt(value, row) ) {
-            if (used)
-                result.append(sep);
-            used = true;
-            result.append( row >= 0 ? m_proxy->itemData(currentTab(), row, mime)
-                                    : m_proxy->getClipboardData(mime) );
+            rows.append(row);
+            mimes.append(mime);
         } else {
             mime = toString(value);
         }
     }
 
-    if (!used)
-        result.append( m_proxy->getClipboardData(mime) );
+    if ( rows.isEmpty() )
+        return newByteArray( m_proxy->getClipboardData(mime) );
+
+    int tab = -1;
+    bool used = false;
+    for ( int i = 0; i < rows.size(); ) {
+        // Item rows following each other with same MIME type.
+        QVariantList itemRows;
+        int j = i;
+        for ( ; j < rows.size() && rows[j] >= 0 && mimes[j] == mimes[i]; ++j )
+            itemRows.append(rows[j]);
+
+        QVariantList items;
+        if ( itemRows.isEmpty() ) {
+            items.append( m_proxy->getClipboardData(mimes[i]) );
+            ++j;
+        } else {
+            if (tab == -1)
+                tab = currentTab();
+            items = m_proxy->itemsData(tab, itemRows, mimes[i]);
+        }
+
+        foreach (const QVariant &item, items) {
+            if (used)
+                result.append(sep);
+            used = true;
+            result.append( item.toByteArray() );
+        }
+
+        i = j;
+    }
 
     return newByteArray(result);
 }
@@ -763,27 +806,35 @@ QScriptValue Scriptable::separator()
 
 void Scriptable::action()
 {
-    QString text;
+    // Item data are not decoded to text and data of a single item are not copied.
+    QByteArray bytes;
     bool anyRows = false;
     int tab = currentTab();
     int i;
     QScriptValue value;
-    QString sep = getInputSeparator();
+    const QByteArray sep = getInputSeparator().toUtf8();
 
+    QVariantList rows;
     for ( i = 0; i < argumentCount(); ++i ) {
         value = argument(i);
         int row;
         if (!toInt(value, row))
             break;
-        if (anyRows)
-            text.append(sep);
-        else
-            anyRows = true;
-        text.append( QString::fromUtf8(m_proxy->itemData(tab, row, defaultMime)) );
+        rows.append(row);
+    }
+
+    if ( !rows.isEmpty() ) {
+        foreach ( const QVariant &item, m_proxy->itemsData(tab, rows, defaultMime) ) {
+            if (anyRows)
+                bytes.append(sep);
+            else
+                anyRows = true;
+            bytes.append( item.toByteArray() );
+        }
     }
 
     if (!anyRows) {
-        text = QString::fromUtf8( m_proxy->getClipboardData(defaultMime) );
+        bytes = m_proxy->getClipboardData(defaultMime);
     }
 
     if (i < argumentCount()) {
@@ -796,11 +847,11 @@ void Scriptable::action()
         command.sep = ((i + 1) < argumentCount()) ? toString( argument(i + 1) )
                                                   : QString('\n');
         QMimeData data;
-        data.setText(text);
+        data.setData(defaultMime, bytes);
         m_proxy->action(data, command);
     } else {
         QMimeData data;
-        data.setText(text);
+        data.setData(defaultMime, bytes);
         QByteArray message = QByteArray::number((qlonglong)m_proxy->openActionDialog(data));
         emit sendMessage(message, CommandActivateWindow);
     }
@@ -877,10 +928,17 @@ QScriptValue Scriptable::config()
     return QScriptValue();
 }
 
+QScriptValue Scriptable::stats()
+{
+    // Include current scripting statistics (otherwise updated after each command).
+    m_proxy->setStats( "scripts", ScriptEnginePool::instance()->stats() );
+    return m_proxy->stats();
+}
+
 void Scriptable::eval()
 {
     const QString script = arg(0);
-    engine()->evaluate(script);
+    engine()->evaluate( m_programs.program(script) );
 }
 
 void Scriptable::currentpath()
@@ -921,3 +979,17 @@ int Scriptable::getTabIndexOrError(const QString &name)
         throwError( tr("Tab with given name doesn't exist!") );
     return i;
 }
+
+void Scriptable::setGlobalObject()
+{
+    QScriptEngine::QObjectWrapOptions opts =
+              QScriptEngine::ExcludeChildObjects
+            | QScriptEngine::SkipMethodsInEnumeration
+            | QScriptEngine::ExcludeSuperClassMethods
+            | QScriptEngine::ExcludeSuperClassProperties
+            | QScriptEngine::ExcludeSuperClassContents
+            | QScriptEngine::ExcludeDeleteLater;
+    QScriptValue obj = m_engine->newQObject(this, QScriptEngine::QtOwnership, opts);
+    m_engine->setGlobalObject(obj);
+    obj.setProperty( "ByteArray", m_baClass->constructor() );
+}
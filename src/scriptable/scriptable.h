@@ -21,6 +21,7 @@
 #define SCRIPTABLE_H
 
 #include "scriptableproxy.h"
+#include "scriptprogramcache.h"
 
 #include <QObject>
 #include <QString>
@@ -43,6 +44,12 @@ public:
 
     void initEngine(QScriptEngine *engine, const QString &currentPath);
 
+    /**
+     * Reset state and global variables so the engine can be used for another
+     * command (see ScriptEnginePool).
+     */
+    void reset(const QString &currentPath);
+
     QScriptValue newByteArray(const QByteArray &bytes);
 
     QString toString(const QScriptValue &value) const;
@@ -120,6 +127,8 @@ public slots:
 
     QScriptValue config();
 
+    QScriptValue stats();
+
     void eval();
 
     void currentpath();
@@ -135,8 +144,12 @@ private:
     QString m_currentTab;
     QString m_inputSeparator;
     QString m_currentPath;
+    ScriptProgramCache m_programs; //!< Scripts compiled in eval().
 
     int getTabIndexOrError(const QString &name);
+
+    /** Set new global object for engine (wraps this object). */
+    void setGlobalObject();
 };
 
 #endif // SCRIPTABLE_H
@@ -198,6 +198,7 @@ public:
     PROXY_METHOD_0(bool, toggleMenu)
     PROXY_METHOD_0(WId, mainWinId)
     PROXY_METHOD_0(WId, trayMenuWinId)
+    PROXY_METHOD_0(QString, stats)
     PROXY_METHOD_1(int, findTabIndex, const QString &)
     PROXY_METHOD_2(ClipboardBrowser *, createTab, const QString &, bool)
 
@@ -206,6 +207,8 @@ public:
     PROXY_METHOD_1(WId, openActionDialog, const QMimeData &)
     PROXY_METHOD_VOID_2(action, const QMimeData &, const Command &)
 
+    PROXY_METHOD_VOID_2(setStats, const QString &, const QVariantMap &)
+
     PROXY_METHOD_1(bool, loadTab, const QString &)
     PROXY_METHOD_2(bool, saveTab, const QString &, int)
 
@@ -220,8 +223,8 @@ public:
     PROXY_METHOD_BROWSER_VOID_1(moveToClipboard, int)
     PROXY_METHOD_BROWSER_VOID_1(delayedSaveItems, int)
     PROXY_METHOD_BROWSER_VOID_1(removeRow, int)
+    PROXY_METHOD_BROWSER_VOID_1(removeRows, const QVariantList &)
     PROXY_METHOD_BROWSER_VOID_1(setCurrent, int)
-    PROXY_METHOD_BROWSER_0(int, length)
     PROXY_METHOD_BROWSER_1(bool, openEditor, const QByteArray &)
 
     PROXY_METHOD_BROWSER_2(bool, add, const QString &, bool)
@@ -231,6 +234,48 @@ public:
 
     PROXY_METHOD_BROWSER_2(QByteArray, itemData, int, const QString &)
 
+    /** Return number of items (doesn't wait for GUI thread). */
+    int length(int i)
+    {
+        ClipboardBrowser *browser = m_wnd->browser(i);
+        return browser != NULL ? browser->publishedLength() : 0;
+    }
+
+    /**
+     * Return data of items in given @a rows.
+     *
+     * Reads snapshots published by GUI thread so it doesn't wait unless
+     * current row (negative row number) is requested.
+     */
+    QVariantList itemsData(int i, const QVariantList &rows, const QString &mime)
+    {
+        bool currentRow = false;
+        foreach (const QVariant &row, rows)
+            currentRow = currentRow || row.toInt() < 0;
+
+        QVariantList retVal;
+
+        if (currentRow) {
+            BEGIN_INVOKE_BROSER("itemsData", i)
+                , Q_RETURN_ARG(QVariantList, retVal)
+                , Q_ARG(const QVariantList &, rows)
+                , Q_ARG(const QString &, mime)
+            END_INVOKE
+            return retVal;
+        }
+
+        ClipboardBrowser *browser = m_wnd->browser(i);
+        if (browser == NULL)
+            return retVal;
+
+        QList<ClipboardItemSnapshotPtr> snapshots;
+        browser->itemSnapshots(rows, &snapshots);
+        foreach (const ClipboardItemSnapshotPtr &item, snapshots)
+            retVal.append( item.isNull() ? QByteArray() : item->value(mime) );
+
+        return retVal;
+    }
+
 private:
     MainWindow *m_wnd;
 };
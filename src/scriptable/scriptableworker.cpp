@@ -20,41 +20,79 @@
 #include "scriptableworker.h"
 
 #include "scriptable.h"
+#include "scriptenginepool.h"
 #include "../qt/bytearrayclass.h"
 
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QLocalSocket>
+#include <QMetaObject>
+#include <QMutexLocker>
 #include <QScriptEngine>
-#include <QThread>
 
 Q_DECLARE_METATYPE(QByteArray*)
 
+namespace {
+
+/// Maximum output size waiting to be written to client before script is blocked.
+const qint64 maxPendingClientBytes = 4 * 1024 * 1024;
+
+/// Size of result message chunks.
+const int responseChunkSize = 64 * 1024;
+
+/// Size of message length and exit code written to socket with each message.
+const int messageHeaderSize = 2 * sizeof(quint32);
+
+#ifdef COPYQ_LOG_DEBUG
+void logScriptState(const QString &state)
+{
+    COPYQ_LOG( QString("Starting scripting engine: %1").arg(state) );
+}
+#else
+inline void logScriptState(const QString &) {}
+#endif
+
+} // namespace
+
 ScriptableWorker::ScriptableWorker(MainWindow *mainWindow, const Arguments &args,
-                                   QLocalSocket *client, QObject *parent)
+                                   QLocalSocket *client, int requestId, QObject *parent)
     : QObject(parent)
     , QRunnable()
     , m_wnd(mainWindow)
     , m_args(args)
     , m_client(client)
+    , m_hasClient(client != NULL)
+    , m_requestId(requestId)
     , m_terminated(false)
+    , m_pendingBytes(0)
+    , m_pendingBytesMutex()
+    , m_pendingBytesChanged()
+    , m_clientBytesWritten(0)
+    , m_pendingMessages()
 {
     setAutoDelete(false);
+
+    if (m_hasClient) {
+        connect( client, SIGNAL(bytesWritten(qint64)),
+                 this, SLOT(onClientBytesWritten(qint64)) );
+        connect( this, SIGNAL(messageReady(QByteArray,int)),
+                 this, SLOT(writeMessage(QByteArray,int)), Qt::QueuedConnection );
+        if ( client->state() != QLocalSocket::ConnectedState )
+            m_terminated = true;
+    }
 }
 
 void ScriptableWorker::run()
 {
-    if (!m_terminated) {
-        if (m_client == NULL) {
-            executeScript();
-        } else {
-            QByteArray response;
-            int exitCode = executeScript(&response);
-
-            if ( exitCode == CommandBadSyntax )
-                response = tr("Bad command syntax. Use -h for help.\n").toLocal8Bit();
-            emit sendMessage(m_client, response, exitCode);
-
-            emit sendMessage(m_client, QByteArray(), CommandFinished);
+    if ( !isTerminated() ) {
+        const CommandStatus status = executeScript();
+
+        if (m_hasClient) {
+            if ( status == CommandBadSyntax )
+                onSendMessage( tr("Bad command syntax. Use -h for help.\n").toLocal8Bit(), status );
+
+            if ( !isTerminated() )
+                emit messageReady(QByteArray(), CommandFinished);
         }
     }
 
@@ -63,76 +101,194 @@ void ScriptableWorker::run()
 
 void ScriptableWorker::terminate()
 {
-    m_terminated = true;
+    {
+        QMutexLocker lock(&m_pendingBytesMutex);
+        m_terminated = true;
+        m_pendingBytesChanged.wakeAll();
+    }
     emit terminateScriptable();
 }
 
 void ScriptableWorker::onSendMessage(const QByteArray &message, int exitCode)
 {
-    if (m_client != NULL)
-        emit sendMessage(m_client, message, exitCode);
-    else
+    if (!m_hasClient) {
         QApplication::exit(0);
+        return;
+    }
+
+    {
+        QMutexLocker lock(&m_pendingBytesMutex);
+        while ( !m_terminated && m_pendingBytes > maxPendingClientBytes )
+            m_pendingBytesChanged.wait(&m_pendingBytesMutex);
+        if (m_terminated)
+            return;
+        m_pendingBytes += messageSize(message);
+    }
+
+    emit messageReady(message, exitCode);
 }
 
-CommandStatus ScriptableWorker::executeScript(QByteArray *response)
+void ScriptableWorker::writeMessage(const QByteArray &message, int exitCode)
 {
-#ifdef COPYQ_LOG_DEBUG
-        const QString msg = QString("Starting scripting engine: %2");
-#endif
+    const qint64 size = messageSize(message);
+
+    if ( m_client.isNull() || m_client->state() != QLocalSocket::ConnectedState ) {
+        removePendingBytes(size);
+        return;
+    }
+
+    emit sendMessage(m_client, message, exitCode, m_requestId);
+
+    // Socket writes buffered data in order so message ends after all buffered bytes.
+    if ( !m_client.isNull() ) {
+        PendingMessage pending;
+        pending.end = m_clientBytesWritten + m_client->bytesToWrite();
+        pending.size = qMin(size, m_client->bytesToWrite());
+        pending.written = 0;
+        removePendingBytes(size - pending.size);
+        if (pending.size > 0)
+            m_pendingMessages.enqueue(pending);
+    }
+}
+
+void ScriptableWorker::onClientBytesWritten(qint64 bytes)
+{
+    m_clientBytesWritten += bytes;
+
+    qint64 written = 0;
+    while ( !m_pendingMessages.isEmpty() ) {
+        PendingMessage &pending = m_pendingMessages.head();
+        const qint64 start = pending.end - pending.size;
+        if (start >= m_clientBytesWritten)
+            break;
+
+        const qint64 messageWritten = qMin(pending.size, m_clientBytesWritten - start);
+        written += messageWritten - pending.written;
+        pending.written = messageWritten;
 
-    COPYQ_LOG( msg.arg("starting") );
+        if (pending.written < pending.size)
+            break;
+        m_pendingMessages.dequeue();
+    }
+
+    if (written > 0)
+        removePendingBytes(written);
+}
+
+void ScriptableWorker::sendResult(const QScriptValue &result)
+{
+    const QByteArray *bytes = qscriptvalue_cast<QByteArray*>(result.data());
+    if (bytes != NULL) {
+        // Data are shared with the result so only single chunk is copied at a time.
+        const QByteArray data = *bytes;
+        for (int i = 0; i < data.size() && !isTerminated(); i += responseChunkSize)
+            onSendMessage( data.mid(i, responseChunkSize), CommandSuccess );
+    } else if ( !result.isUndefined() ) {
+        const QString text = result.toString() + '\n';
+        for (int i = 0; i < text.size() && !isTerminated(); ) {
+            int size = qMin(responseChunkSize, text.size() - i);
+            if ( i + size < text.size() && text[i + size - 1].isHighSurrogate() )
+                --size;
+            onSendMessage( text.mid(i, size).toLocal8Bit(), CommandSuccess );
+            i += size;
+        }
+    }
+}
+
+qint64 ScriptableWorker::messageSize(const QByteArray &message) const
+{
+    qint64 size = message.size() + messageHeaderSize;
+    if (m_requestId >= 0)
+        size += sizeof(quint32);
+    return size;
+}
+
+bool ScriptableWorker::isTerminated()
+{
+    QMutexLocker lock(&m_pendingBytesMutex);
+    return m_terminated;
+}
+
+void ScriptableWorker::removePendingBytes(qint64 bytes)
+{
+    QMutexLocker lock(&m_pendingBytesMutex);
+    m_pendingBytes = qMax<qint64>(0, m_pendingBytes - bytes);
+    m_pendingBytesChanged.wakeAll();
+}
+
+CommandStatus ScriptableWorker::executeScript()
+{
+    logScriptState("starting");
 
     if ( m_args.length() <= Arguments::Rest ) {
-        COPYQ_LOG( msg.arg("bad command syntax") );
+        logScriptState("bad command syntax");
         return CommandBadSyntax;
     }
-    const QString cmd = QString::fromUtf8( m_args.at(Arguments::Rest) );
 
-    QScriptEngine engine;
-    ScriptableProxy proxy(m_wnd);
-    Scriptable scriptable(&proxy);
+    QElapsedTimer t;
+    t.start();
+
+    ScriptEnginePool *pool = ScriptEnginePool::instance();
+    PooledScriptEngine *pooledEngine =
+            pool->acquire( m_wnd, QString::fromUtf8(m_args.at(Arguments::CurrentPath)) );
+    Scriptable &scriptable = pooledEngine->scriptable;
+
     scriptable.abort();
-    scriptable.initEngine( &engine, QString::fromUtf8(m_args.at(Arguments::CurrentPath)) );
-    if (m_client != NULL) {
-        connect(&scriptable, SIGNAL(sendMessage(QByteArray,int)),
-                SLOT(onSendMessage(QByteArray,int)));
+    if (m_hasClient) {
+        // Message is sent from script thread so it can wait for client.
+        connect( &scriptable, SIGNAL(sendMessage(QByteArray,int)),
+                 this, SLOT(onSendMessage(QByteArray,int)), Qt::DirectConnection );
     }
 
     connect( this, SIGNAL(terminateScriptable()),
              &scriptable, SLOT(abort()) );
 
+    const CommandStatus status = executeScript(&pooledEngine->engine, &scriptable);
+
+    // Engine is used by another command later.
+    disconnect( &scriptable, NULL, this, NULL );
+    disconnect( this, NULL, &scriptable, NULL );
+    QCoreApplication::removePostedEvents(&scriptable);
+    pool->release( pooledEngine, t.elapsed() );
+
+    QMetaObject::invokeMethod( m_wnd, "setStats", Qt::QueuedConnection,
+                               Q_ARG(QString, "scripts"),
+                               Q_ARG(QVariantMap, pool->stats()) );
+
+    return status;
+}
+
+CommandStatus ScriptableWorker::executeScript(QScriptEngine *engine, Scriptable *scriptable)
+{
+    const QString cmd = QString::fromUtf8( m_args.at(Arguments::Rest) );
+
     QScriptValue result;
     QScriptValueList fnArgs;
 
-    QScriptValue fn = engine.globalObject().property(cmd);
+    QScriptValue fn = engine->globalObject().property(cmd);
     if ( !fn.isFunction() ) {
-        COPYQ_LOG( msg.arg("unknown command") );
+        logScriptState("unknown command");
         return CommandBadSyntax;
     }
 
     for ( int i = Arguments::Rest + 1; i < m_args.length(); ++i )
-        fnArgs.append( scriptable.newByteArray(m_args.at(i)) );
+        fnArgs.append( scriptable->newByteArray(m_args.at(i)) );
 
     result = fn.call(QScriptValue(), fnArgs);
 
-    if ( engine.hasUncaughtException() ) {
-        COPYQ_LOG( msg.arg("command error (\"%1\")").arg(cmd) );
-        if (response != NULL)
-            response->append(engine.uncaughtException().toString() + '\n');
-        engine.clearExceptions();
+    if ( engine->hasUncaughtException() ) {
+        logScriptState( QString("command error (\"%1\")").arg(cmd) );
+        // Client exits after first error message so send it whole.
+        if (m_hasClient)
+            onSendMessage( (engine->uncaughtException().toString() + '\n').toLocal8Bit(), CommandError );
+        engine->clearExceptions();
         return CommandError;
     }
 
-    QByteArray *bytes = qscriptvalue_cast<QByteArray*>(result.data());
-    if (response != NULL) {
-        if (bytes != NULL)
-            response->append(*bytes);
-        else if (!result.isUndefined())
-            response->append(result.toString() + '\n');
-    }
+    if (m_hasClient)
+        sendResult(result);
 
-    COPYQ_LOG( msg.arg("finished") );
+    logScriptState("finished");
 
     return CommandSuccess;
 }
@@ -23,38 +23,113 @@
 #include "common/arguments.h"
 #include "common/client_server.h"
 
-#include <QRunnable>
+#include <QMutex>
 #include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QRunnable>
+#include <QWaitCondition>
 
 class MainWindow;
 class QLocalSocket;
+class QScriptEngine;
+class QScriptValue;
+class Scriptable;
 
+/**
+ * Runs command from client (or internal command) in a thread pool.
+ *
+ * Output for client is streamed in messages as it's produced. If client
+ * doesn't read the output fast enough, the script waits in print() until
+ * the amount of unsent output drops under a limit.
+ */
 class ScriptableWorker : public QObject, public QRunnable
 {
     Q_OBJECT
 public:
+    /**
+     * Worker for command in @a args.
+     *
+     * If @a requestId is non-negative, it's passed with each message for
+     * @a client (command from batch session).
+     */
     ScriptableWorker(MainWindow *mainWindow, const Arguments &args, QLocalSocket *client,
-                     QObject *parent = NULL);
+                     int requestId = -1, QObject *parent = NULL);
 
 signals:
-    void sendMessage(QLocalSocket *client, const QByteArray &message, int exitCode);
+    /** Write message to client (emitted in main thread only if client still exists). */
+    void sendMessage(QLocalSocket *client, const QByteArray &message, int exitCode,
+                     int requestId);
     void finished();
     void terminateScriptable();
 
+    /** Message from script thread is ready to be written (see writeMessage()). */
+    void messageReady(const QByteArray &message, int exitCode);
+
 public slots:
     void run();
     void terminate();
 
 private slots:
+    /**
+     * Send message to client.
+     *
+     * Called from script thread; blocks while too much output is unsent.
+     */
     void onSendMessage(const QByteArray &message, int exitCode);
 
+    /** Pass message to client if it's still connected (called from main thread). */
+    void writeMessage(const QByteArray &message, int exitCode);
+
+    /** Client socket written some data (called from main thread). */
+    void onClientBytesWritten(qint64 bytes);
+
 private:
-    CommandStatus executeScript(QByteArray *response = NULL);
+    CommandStatus executeScript();
+
+    /** Send script @a result to client in smaller messages as it's converted. */
+    void sendResult(const QScriptValue &result);
+
+    CommandStatus executeScript(QScriptEngine *engine, Scriptable *scriptable);
+
+    /** Size of message written to client including message header. */
+    qint64 messageSize(const QByteArray &message) const;
+
+    /** Return true if terminate() was called. */
+    bool isTerminated();
+
+    /** Decrease number of bytes waiting to be written to client. */
+    void removePendingBytes(qint64 bytes);
+
+    /** Message of this worker in socket write buffer (used only in main thread). */
+    struct PendingMessage {
+        qint64 end; //!< Position after message in all bytes written by socket.
+        qint64 size;
+        qint64 written;
+    };
 
     MainWindow *m_wnd;
     Arguments m_args;
-    QLocalSocket *m_client;
+    /** Client socket (accessed only in main thread since it can be deleted). */
+    QPointer<QLocalSocket> m_client;
+    bool m_hasClient;
+    int m_requestId;
     bool m_terminated;
+
+    /** Bytes of this worker sent to client but not yet written to socket. */
+    qint64 m_pendingBytes;
+    QMutex m_pendingBytesMutex;
+    QWaitCondition m_pendingBytesChanged;
+
+    /**
+     * Bytes written by client socket since the worker was created and
+     * messages of this worker not yet written.
+     *
+     * Other commands (in batch session) can write to same socket so only bytes
+     * of these messages are removed from m_pendingBytes.
+     */
+    qint64 m_clientBytesWritten;
+    QQueue<PendingMessage> m_pendingMessages;
 };
 
 #endif // SCRIPTABLEWORKER_H
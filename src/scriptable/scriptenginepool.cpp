@@ -0,0 +1,220 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "scriptenginepool.h"
+
+#include "scriptprogramcache.h"
+
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QScriptValueIterator>
+#include <QThreadPool>
+#include <qnumeric.h>
+
+namespace {
+
+/// Built-in objects checked for changes before engine is reused.
+const char *const builtinObjectNames[] = {
+    "Object", "Object.prototype", "Function", "Function.prototype",
+    "Array", "Array.prototype", "String", "String.prototype",
+    "Number", "Number.prototype", "Boolean", "Boolean.prototype",
+    "Date", "Date.prototype", "RegExp", "RegExp.prototype",
+    "Error", "Error.prototype", "Math", "JSON"
+};
+
+/** Store current properties of built-in object with given @a name. */
+BuiltinObjectState builtinObjectState(QScriptEngine *engine, const QString &name)
+{
+    BuiltinObjectState state;
+    state.name = name;
+    state.object = engine->evaluate(name);
+    engine->clearExceptions();
+
+    // Iterator includes non-enumerable properties.
+    QScriptValueIterator it(state.object);
+    while ( it.hasNext() ) {
+        it.next();
+        state.propertyNames.append( it.name() );
+        state.propertyValues.append( it.value() );
+    }
+
+    return state;
+}
+
+bool isSameValue(const QScriptValue &a, const QScriptValue &b)
+{
+    if ( a.strictlyEquals(b) )
+        return true;
+
+    // NaN is not equal to itself.
+    return a.isNumber() && b.isNumber() && qIsNaN(a.toNumber()) && qIsNaN(b.toNumber());
+}
+
+/** Creates engine for thread in pool. */
+class WarmUpTask : public QRunnable
+{
+public:
+    explicit WarmUpTask(MainWindow *wnd) : m_wnd(wnd) {}
+
+    void run()
+    {
+        ScriptEnginePool *pool = ScriptEnginePool::instance();
+        pool->release( pool->acquire(m_wnd, QString()), -1 );
+    }
+
+private:
+    MainWindow *m_wnd;
+};
+
+} // namespace
+
+PooledScriptEngine::PooledScriptEngine(MainWindow *mainWindow)
+    : wnd(mainWindow)
+    , engine()
+    , proxy(mainWindow)
+    , scriptable(&proxy)
+    , used(false)
+    , builtins()
+{
+    scriptable.initEngine( &engine, QString() );
+
+    for (size_t i = 0; i < sizeof(builtinObjectNames) / sizeof(builtinObjectNames[0]); ++i)
+        builtins.append( builtinObjectState(&engine, builtinObjectNames[i]) );
+}
+
+bool PooledScriptEngine::builtinsModified()
+{
+    foreach (const BuiltinObjectState &original, builtins) {
+        const BuiltinObjectState current = builtinObjectState(&engine, original.name);
+        if ( !current.object.strictlyEquals(original.object)
+             || current.propertyNames != original.propertyNames )
+        {
+            return true;
+        }
+
+        // RegExp constructor holds results of last match.
+        const bool onlyObjects = original.name == "RegExp";
+
+        for (int i = 0; i < current.propertyValues.size(); ++i) {
+            const QScriptValue &value = current.propertyValues[i];
+            const QScriptValue &originalValue = original.propertyValues[i];
+            if ( onlyObjects && !value.isObject() && !originalValue.isObject() )
+                continue;
+            if ( !isSameValue(value, originalValue) )
+                return true;
+        }
+    }
+
+    return false;
+}
+
+ScriptEnginePool *ScriptEnginePool::instance()
+{
+    static ScriptEnginePool pool;
+    return &pool;
+}
+
+ScriptEnginePool::ScriptEnginePool()
+    : m_engines()
+    , m_statsMutex()
+    , m_created(0)
+    , m_reused(0)
+    , m_discarded(0)
+    , m_startupLatency()
+    , m_commandLatency()
+{
+}
+
+PooledScriptEngine *ScriptEnginePool::acquire(MainWindow *wnd, const QString &currentPath)
+{
+    PooledScriptEngine *engine = m_engines.hasLocalData() ? m_engines.localData() : NULL;
+
+    if ( engine != NULL && !engine->used && engine->wnd == wnd ) {
+        engine->scriptable.reset(currentPath);
+        engine->used = true;
+
+        QMutexLocker lock(&m_statsMutex);
+        ++m_reused;
+        return engine;
+    }
+
+    QElapsedTimer t;
+    t.start();
+    PooledScriptEngine *newEngine = new PooledScriptEngine(wnd);
+    newEngine->scriptable.setCurrentPath(currentPath);
+    newEngine->used = true;
+    const qint64 ms = t.elapsed();
+
+    // Keep engine for thread (unless the thread's engine is being used).
+    if (engine == NULL || !engine->used)
+        m_engines.setLocalData(newEngine);
+
+    QMutexLocker lock(&m_statsMutex);
+    ++m_created;
+    m_startupLatency.addSample(ms);
+
+    return newEngine;
+}
+
+void ScriptEnginePool::release(PooledScriptEngine *engine, qint64 commandMs)
+{
+    const bool isThreadEngine = m_engines.hasLocalData() && m_engines.localData() == engine;
+
+    if ( engine->builtinsModified() ) {
+        if (isThreadEngine)
+            m_engines.setLocalData(NULL); // deletes the engine
+        else
+            delete engine;
+
+        QMutexLocker lock(&m_statsMutex);
+        ++m_discarded;
+    } else if (isThreadEngine) {
+        engine->used = false;
+    } else {
+        delete engine;
+    }
+
+    if (commandMs >= 0) {
+        QMutexLocker lock(&m_statsMutex);
+        m_commandLatency.addSample(commandMs);
+    }
+}
+
+void ScriptEnginePool::warmUp(QThreadPool *threads, MainWindow *wnd)
+{
+    threads->start( new WarmUpTask(wnd) );
+}
+
+QVariantMap ScriptEnginePool::stats() const
+{
+    QMutexLocker lock(&m_statsMutex);
+
+    QVariantMap stats;
+    stats["engines_created"] = m_created;
+    stats["engines_reused"] = m_reused;
+    stats["engines_discarded"] = m_discarded;
+    stats["engine_startup_latency"] = m_startupLatency.toString();
+    stats["command_latency"] = m_commandLatency.toString();
+
+    const QVariantMap cacheStats = ScriptProgramCache::stats();
+    foreach ( const QString &name, cacheStats.keys() )
+        stats[name] = cacheStats[name];
+
+    return stats;
+}
@@ -0,0 +1,112 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCRIPTENGINEPOOL_H
+#define SCRIPTENGINEPOOL_H
+
+#include "scriptable.h"
+#include "scriptableproxy.h"
+
+#include "common/latencyhistogram.h"
+
+#include <QList>
+#include <QMutex>
+#include <QScriptEngine>
+#include <QScriptValue>
+#include <QStringList>
+#include <QThreadStorage>
+#include <QVariantMap>
+
+class MainWindow;
+class QThreadPool;
+
+/** Properties of built-in object (see PooledScriptEngine::builtinsModified()). */
+struct BuiltinObjectState {
+    QString name;
+    QScriptValue object;
+    QStringList propertyNames;
+    QList<QScriptValue> propertyValues;
+};
+
+/** Initialized scripting engine with global Scriptable object. */
+struct PooledScriptEngine {
+    explicit PooledScriptEngine(MainWindow *mainWindow);
+
+    /**
+     * Return true if script changed built-in objects (e.g. Array.prototype).
+     *
+     * Such changes would persist in next command so the engine must not be reused.
+     */
+    bool builtinsModified();
+
+    MainWindow *wnd;
+    QScriptEngine engine;
+    ScriptableProxy proxy;
+    Scriptable scriptable;
+    bool used;
+    QList<BuiltinObjectState> builtins;
+};
+
+/**
+ * Scripting engines reused for commands.
+ *
+ * Creating and initializing QScriptEngine is expensive compared to running
+ * most commands. Each thread keeps its engine after command finishes and uses
+ * it for next command (state of Scriptable and global variables are reset).
+ * Engine is discarded if command modified built-in objects.
+ *
+ * Engines are never shared between threads (engine is deleted when its thread
+ * finishes).
+ */
+class ScriptEnginePool
+{
+public:
+    /** Return singleton instance. */
+    static ScriptEnginePool *instance();
+
+    /**
+     * Return engine for current thread (creates new one if needed).
+     *
+     * Call release() when command finishes.
+     */
+    PooledScriptEngine *acquire(MainWindow *wnd, const QString &currentPath);
+
+    /** Release engine and record command latency. */
+    void release(PooledScriptEngine *engine, qint64 commandMs);
+
+    /** Initialize an engine in one of the @a threads in advance. */
+    void warmUp(QThreadPool *threads, MainWindow *wnd);
+
+    /** Return statistics (engine startup and command latency). */
+    QVariantMap stats() const;
+
+private:
+    ScriptEnginePool();
+
+    QThreadStorage<PooledScriptEngine *> m_engines;
+
+    mutable QMutex m_statsMutex;
+    int m_created;
+    int m_reused;
+    int m_discarded;
+    LatencyHistogram m_startupLatency;
+    LatencyHistogram m_commandLatency;
+};
+
+#endif // SCRIPTENGINEPOOL_H
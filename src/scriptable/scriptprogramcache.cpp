@@ -0,0 +1,95 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "scriptprogramcache.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+
+namespace {
+
+/// Longer scripts are not cached.
+const int maxCachedScriptLength = 16 * 1024;
+
+QMutex statsMutex;
+int cacheHits = 0;
+int cacheMisses = 0;
+int cacheEvictions = 0;
+
+} // namespace
+
+ScriptProgramCache::ScriptProgramCache(int maxSize)
+    : m_maxSize(maxSize)
+    , m_useCounter(0)
+    , m_programs()
+{
+}
+
+QScriptProgram ScriptProgramCache::program(const QString &script)
+{
+    if ( m_maxSize <= 0 || script.size() > maxCachedScriptLength )
+        return QScriptProgram(script);
+
+    QHash<QString, CachedProgram>::iterator it = m_programs.find(script);
+    if ( it != m_programs.end() ) {
+        it->lastUse = ++m_useCounter;
+
+        QMutexLocker lock(&statsMutex);
+        ++cacheHits;
+        return it->program;
+    }
+
+    bool evicted = false;
+    if ( m_programs.size() >= m_maxSize ) {
+        // Remove least recently used program.
+        QHash<QString, CachedProgram>::iterator lru = m_programs.begin();
+        for ( it = m_programs.begin(); it != m_programs.end(); ++it ) {
+            if (it->lastUse < lru->lastUse)
+                lru = it;
+        }
+        m_programs.erase(lru);
+        evicted = true;
+    }
+
+    CachedProgram &cached = m_programs[script];
+    cached.program = QScriptProgram(script);
+    cached.lastUse = ++m_useCounter;
+
+    QMutexLocker lock(&statsMutex);
+    ++cacheMisses;
+    if (evicted)
+        ++cacheEvictions;
+
+    return cached.program;
+}
+
+QVariantMap ScriptProgramCache::stats()
+{
+    QMutexLocker lock(&statsMutex);
+
+    const int lookups = cacheHits + cacheMisses;
+
+    QVariantMap stats;
+    stats["program_cache_hits"] = cacheHits;
+    stats["program_cache_misses"] = cacheMisses;
+    stats["program_cache_evictions"] = cacheEvictions;
+    stats["program_cache_hit_rate"] =
+            QString("%1%").arg(lookups > 0 ? 100 * cacheHits / lookups : 0);
+    return stats;
+}
@@ -0,0 +1,59 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCRIPTPROGRAMCACHE_H
+#define SCRIPTPROGRAMCACHE_H
+
+#include <QHash>
+#include <QScriptProgram>
+#include <QString>
+#include <QVariantMap>
+
+/**
+ * Recently evaluated scripts compiled to QScriptProgram objects.
+ *
+ * Least recently used program is removed if cache is full.
+ *
+ * Compiled program is bound to an engine (evaluating it in another engine
+ * compiles it again) so each engine needs its own cache. Statistics are
+ * shared by all caches.
+ */
+class ScriptProgramCache
+{
+public:
+    explicit ScriptProgramCache(int maxSize = 64);
+
+    /** Return compiled @a script (compiles it if it's not in cache). */
+    QScriptProgram program(const QString &script);
+
+    /** Return statistics for all caches (hits, misses, hit rate). */
+    static QVariantMap stats();
+
+private:
+    struct CachedProgram {
+        QScriptProgram program;
+        qint64 lastUse;
+    };
+
+    int m_maxSize;
+    qint64 m_useCounter;
+    QHash<QString, CachedProgram> m_programs;
+};
+
+#endif // SCRIPTPROGRAMCACHE_H
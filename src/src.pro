@@ -16,15 +16,21 @@ FORMS += \
     ui/commandwidget.ui
 HEADERS += \
     app/app.h \
+    app/argumentreceiver.h \
+    app/batchsession.h \
     app/clipboardclient.h \
+    app/clipboardingest.h \
     app/clipboardmonitor.h \
     app/clipboardserver.h \
     app/remoteprocess.h \
     common/action.h \
+    common/actionscheduler.h \
     common/arguments.h \
     common/client_server.h \
     common/command.h \
+    common/commandmatcher.h \
     common/contenttype.h \
+    common/latencyhistogram.h \
     common/option.h \
     gui/aboutdialog.h \
     gui/actiondialog.h \
@@ -53,16 +59,24 @@ HEADERS += \
     scriptable/scriptable.h \
     scriptable/scriptableproxy.h \
     scriptable/scriptableworker.h \
+    scriptable/scriptenginepool.h \
+    scriptable/scriptprogramcache.h \
     gui/tabtree.h
 SOURCES += \
     app/app.cpp \
+    app/argumentreceiver.cpp \
+    app/batchsession.cpp \
     app/clipboardclient.cpp \
+    app/clipboardingest.cpp \
     app/clipboardmonitor.cpp \
     app/clipboardserver.cpp \
     app/remoteprocess.cpp \
     common/action.cpp \
+    common/actionscheduler.cpp \
     common/arguments.cpp \
     common/client_server.cpp \
+    common/commandmatcher.cpp \
+    common/latencyhistogram.cpp \
     common/option.cpp \
     gui/aboutdialog.cpp \
     gui/actiondialog.cpp \
@@ -89,6 +103,8 @@ SOURCES += \
     ../qt/bytearrayprototype.cpp \
     scriptable/scriptable.cpp \
     scriptable/scriptableworker.cpp \
+    scriptable/scriptenginepool.cpp \
+    scriptable/scriptprogramcache.cpp \
     gui/tabtree.cpp
 
 QT += core gui xml network script
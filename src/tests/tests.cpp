@@ -20,18 +20,44 @@
 #include "tests.h"
 
 #include "app/remoteprocess.h"
+#include "common/action.h"
+#include "common/actionscheduler.h"
 #include "common/client_server.h"
+#include "common/commandmatcher.h"
+#include "gui/traymenu.h"
 #include "item/clipboarditem.h"
+#include "platform/platformnativeinterface.h"
 
 #include <QApplication>
 #include <QClipboard>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QLocalServer>
 #include <QLocalSocket>
 #include <QMimeData>
+#include <QPointer>
 #include <QProcess>
+#include <QScopedPointer>
 #include <QTemporaryFile>
 #include <QTest>
 
+#ifdef COPYQ_WS_X11
+#   include "platform/x11/x11selectionreader.h"
+#endif
+
+#ifdef Q_OS_LINUX
+#   include <unistd.h>
+#endif
+
+#ifdef COPYQ_WS_X11
+// Included last since X11 headers define macros conflicting with Qt.
+#   include <X11/Xlib.h>
+#   include <X11/Xatom.h>
+#   ifdef HAS_X11TEST
+#       include <X11/extensions/XTest.h>
+#   endif
+#endif
+
 using QTest::qSleep;
 
 #define VERIFY_SERVER_OUTPUT() \
@@ -119,6 +145,44 @@ int run(const Args &arguments = Args(), QByteArray *stdoutData = NULL, QByteArra
     return p.exitCode();
 }
 
+/// Process events for given interval (in ms) so clipboard owned by tests can be read.
+void waitWithEvents(int ms)
+{
+    QElapsedTimer t;
+    t.start();
+    while ( !t.hasExpired(ms) ) {
+        QApplication::processEvents();
+        qSleep(10);
+    }
+}
+
+/// Return action which waits for a second.
+Action *createSleepAction(const QString &name, bool automatic,
+                          const QString &outputTab = QString())
+{
+    Action::Commands commands;
+    commands.append( QStringList() << "sleep" << "1" );
+    Action *action = new Action(commands, QByteArray(), QString(), QString(),
+                                outputTab, QModelIndex());
+    action->setName(name);
+    action->setAutomatic(automatic);
+    return action;
+}
+
+/// Return resident memory size of the process in bytes (-1 if not available).
+qint64 residentMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile statm("/proc/self/statm");
+    if ( statm.open(QIODevice::ReadOnly) ) {
+        const QList<QByteArray> values = statm.readAll().split(' ');
+        if (values.size() > 1)
+            return values[1].toLongLong() * sysconf(_SC_PAGESIZE);
+    }
+#endif
+    return -1;
+}
+
 bool isAnyServerRunning()
 {
     return run(Args("size")) == 0;
@@ -131,6 +195,37 @@ bool hasTab(const QString &tabName)
     return QString::fromLocal8Bit(out).split(QRegExp("\r\n|\n|\r")).contains(tabName);
 }
 
+#ifdef COPYQ_WS_X11
+void setX11WindowTitle(Display *display, Window w, const QByteArray &title)
+{
+    XChangeProperty( display, w, XInternAtom(display, "_NET_WM_NAME", False),
+                     XInternAtom(display, "UTF8_STRING", False), 8, PropModeReplace,
+                     reinterpret_cast<const unsigned char *>(title.constData()), title.size() );
+    XSync(display, False);
+}
+
+void setX11ActiveWindow(Display *display, Window w)
+{
+    XChangeProperty( display, DefaultRootWindow(display),
+                     XInternAtom(display, "_NET_ACTIVE_WINDOW", False), XA_WINDOW, 32,
+                     PropModeReplace, reinterpret_cast<const unsigned char *>(&w), 1 );
+    XSync(display, False);
+}
+
+/// Wait until platform receives property change events from X server.
+QString waitForWindowTitle(const PlatformPtr &platform, const QString &expectedTitle)
+{
+    QString title;
+    for (int i = 0; i < 20; ++i) {
+        title = platform->getWindowTitle( platform->getCurrentWindow() );
+        if (title == expectedTitle)
+            break;
+        qSleep(50);
+    }
+    return title;
+}
+#endif
+
 } // namespace
 
 Tests::Tests(QObject *parent)
@@ -295,6 +390,44 @@ void Tests::action()
     RUN(Args(args) << "read" << "0", "C");
     RUN(Args(args) << "read" << "1", "B");
     RUN(Args(args) << "read" << "2", "A");
+
+    // action with multi-character separator
+    RUN(Args(argsAction) << action.arg("eval 'print(\"D::E::\")'") << "::", "");
+    qSleep(waitMsAction);
+    RUN(Args(args) << "size", "8\n");
+    RUN(Args(args) << "read" << "0", "E");
+    RUN(Args(args) << "read" << "1", "D");
+
+    // action with regular expression separator
+    RUN(Args(argsAction) << action.arg("eval 'print(\"F ; G;H\")'") << "\\s*;\\s*", "");
+    qSleep(waitMsAction);
+    RUN(Args(args) << "size", "11\n");
+    RUN(Args(args) << "read" << "0", "H");
+    RUN(Args(args) << "read" << "1", "G");
+    RUN(Args(args) << "read" << "2", "F");
+}
+
+void Tests::actionManyItems()
+{
+    const Args args = Args("tab") << testTabs.arg(1);
+    const QString action = QString("%1 %2 %3").arg(QApplication::applicationFilePath())
+            .arg(args.join(" "))
+            .arg("eval 'print(Array(50001).join(\"x\" + String.fromCharCode(10)) + \"END\")'");
+
+    // Command output with many lines is added to tab in batches.
+    QBENCHMARK {
+        RUN(Args(args) << "add" << "START", "");
+        RUN(Args(args) << "action" << action << "\n", "");
+
+        QByteArray stdoutData;
+        for (int i = 0; i < 100 && stdoutData != "END"; ++i) {
+            qSleep(waitMsAction);
+            QCOMPARE( run(Args(args) << "read" << "0", &stdoutData), 0 );
+        }
+        QCOMPARE( stdoutData.data(), "END" );
+    }
+
+    RUN(Args(args) << "read" << "1", "x");
 }
 
 void Tests::insertRemoveItems()
@@ -327,6 +460,12 @@ void Tests::insertRemoveItems()
     RUN(Args(args) << "read" << "2", "abc");
 
     RUN(Args(args) << "read" << "3", "");
+
+    // remove consecutive and unordered rows
+    RUN(Args(args) << "add" << "D" << "E" << "F", "");
+    RUN(Args(args) << "remove" << "1" << "5" << "0" << "3", "");
+    RUN(Args(args) << "read" << "0" << "1" << "2", "D\nABC\n");
+    RUN(Args(args) << "size", "2\n");
 }
 
 void Tests::renameTab()
@@ -417,6 +556,69 @@ void Tests::eval()
     RUN(Args("eval") << QString("tab('%1');if (size() === 1) print('ok')").arg(tab2), "ok");
     RUN(Args("eval") << QString("tab('%1');if (str(read(0)) === 'abc') print('ok')").arg(tab1), "ok");
     RUN(Args("eval") << QString("tab('%1');if (str(read(0)) === 'def') print('ok')").arg(tab2), "ok");
+
+    // Changes of built-in objects must not leak to next script (engines are reused).
+    RUN(Args("eval") << "Array.prototype.join = function() { return 'X' }; String.prototype.y = 1", "");
+    RUN(Args("eval") << "print([1, 2].join('-') + ('').y)", "1-2undefined");
+}
+
+void Tests::evalReadItems()
+{
+    // Script reads items in its own thread; items read after changes must be up to date.
+    const Args args = Args("tab") << testTabs.arg(1);
+    RUN(Args(args) << "eval" << "print(size())", "0");
+    RUN(Args(args) << "eval"
+        << "add('A', 'B'); print(size()); print(str(read(0)));"
+           "add('C'); print(size()); print(str(read(0))); print(str(read(2)));"
+           "remove(0); print(size()); print(str(read(0))); print(str(read(5)));"
+           "print(str(read(1, 0)))",
+        "2B3CA2BA\nB");
+    RUN(Args(args) << "size", "2\n");
+    RUN(Args(args) << "read" << "0", "B");
+}
+
+void Tests::evalLargeOutput()
+{
+    // Output is larger than what server buffers for client.
+    QByteArray stdoutData;
+    QByteArray stderrData;
+    QCOMPARE( run(Args("eval") << "var x = Array(1024 * 1024 + 1).join('x');"
+                                  "for (var i = 0; i < 8; ++i) print(x)",
+                  &stdoutData, &stderrData), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+    QCOMPARE( stdoutData.size(), 8 * 1024 * 1024 );
+    QCOMPARE( stdoutData.count('x'), 8 * 1024 * 1024 );
+
+    QCOMPARE( run(Args("eval") << "for (var i = 0; i < 10000; ++i) print(i + '\\n')",
+                  &stdoutData, &stderrData), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+    QVERIFY( stdoutData.endsWith("\n9999\n") );
+    QCOMPARE( stdoutData.count('\n'), 10000 );
+}
+
+void Tests::batch()
+{
+    const QString tab = testTabs.arg(1);
+
+    const QByteArray in = QString(
+                "tab %1 add A B\n"
+                "# comment\n"
+                "\n"
+                "tab %1 size\n"
+                "tab %1 read 0 1\n"
+                "eval \"print('x y')\"\n"
+                ).arg(tab).toLocal8Bit();
+
+    QByteArray stdoutData;
+    QByteArray stderrData;
+    QCOMPARE( run(Args("batch"), &stdoutData, &stderrData, in), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+    QCOMPARE( stdoutData.data(), "2\nB\nAx y" );
+
+    // Commands after failed command are executed.
+    QCOMPARE( run(Args("batch"), &stdoutData, &stderrData, "eval x\neval 'print(1)'\n"), 1 );
+    QVERIFY( !stderrData.isEmpty() );
+    QCOMPARE( stdoutData.data(), "1" );
 }
 
 void Tests::rawData()
@@ -449,6 +651,339 @@ void Tests::rawData()
     }
 }
 
+void Tests::rawDataLargeInput()
+{
+    const QString tab = testTabs.arg(1);
+    const Args args = Args("tab") << tab;
+
+    // Standard input is sent to server in multiple chunks.
+    QByteArray in;
+    for (int i = 0; in.size() < 10 * 1024 * 1024; ++i)
+        in.append( QByteArray::number(i) + '\n' );
+
+    QByteArray stderrData;
+    QCOMPARE( run(Args(args) << "write" << "application/x-copyq-test" << "-",
+                  NULL, &stderrData, in), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+
+    QByteArray stdoutData;
+    QCOMPARE( run(Args(args) << "read" << "application/x-copyq-test" << "0",
+                  &stdoutData, &stderrData), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+    QCOMPARE( stdoutData.size(), in.size() );
+    QVERIFY( stdoutData == in );
+}
+
+void Tests::stats()
+{
+    setClipboard("TEST_STATS");
+    RUN(Args("eval") << "1", "");
+
+    // Wait until monitor sends statistics to server.
+    qSleep(1500);
+    QApplication::processEvents();
+
+    QByteArray stdoutData;
+    QByteArray stderrData;
+    QCOMPARE( run(Args("stats"), &stdoutData, &stderrData), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+    QVERIFY2( stdoutData.contains("monitor/clipboard_check_latency: count "), stdoutData );
+    QVERIFY2( stdoutData.contains("monitor/clipboard_set_latency: count "), stdoutData );
+    QVERIFY2( stdoutData.contains("server/monitor_events_seen: "), stdoutData );
+    QVERIFY2( stdoutData.contains("server/ingest_latency: count "), stdoutData );
+    QVERIFY2( stdoutData.contains("actions/queued: 0"), stdoutData );
+    QVERIFY2( stdoutData.contains("scripts/command_latency: count "), stdoutData );
+    QVERIFY2( stdoutData.contains("scripts/program_cache_hit_rate: "), stdoutData );
+}
+
+void Tests::windowTitleCache()
+{
+#ifdef COPYQ_WS_X11
+    Display *display = XOpenDisplay(NULL);
+    QVERIFY(display != NULL);
+
+    const Window root = DefaultRootWindow(display);
+    const Window w1 = XCreateSimpleWindow(display, root, 0, 0, 1, 1, 0, 0, 0);
+    const Window w2 = XCreateSimpleWindow(display, root, 0, 0, 1, 1, 0, 0, 0);
+    setX11WindowTitle(display, w1, "TITLE1");
+    setX11WindowTitle(display, w2, "TITLE2");
+    setX11ActiveWindow(display, w1);
+
+    PlatformPtr platform = createPlatformNativeInterface();
+    QCOMPARE( waitForWindowTitle(platform, "TITLE1"), QString("TITLE1") );
+    QCOMPARE( platform->getCurrentWindow(), static_cast<WId>(w1) );
+
+    // Cached title is updated when title of active window changes.
+    setX11WindowTitle(display, w1, "TITLE1 changed");
+    QCOMPARE( waitForWindowTitle(platform, "TITLE1 changed"), QString("TITLE1 changed") );
+
+    // Cached window is updated when other window is activated.
+    setX11ActiveWindow(display, w2);
+    QCOMPARE( waitForWindowTitle(platform, "TITLE2"), QString("TITLE2") );
+    QCOMPARE( platform->getCurrentWindow(), static_cast<WId>(w2) );
+
+    // Destroyed active window is ignored (X11 error must not be fatal).
+    XDestroyWindow(display, w1);
+    setX11ActiveWindow(display, w1);
+    QCOMPARE( waitForWindowTitle(platform, QString()), QString() );
+    QCOMPARE( platform->getCurrentWindow(), static_cast<WId>(0) );
+
+    XDestroyWindow(display, w2);
+    XDeleteProperty( display, root, XInternAtom(display, "_NET_ACTIVE_WINDOW", False) );
+    XCloseDisplay(display);
+#endif
+}
+
+void Tests::commandMatcher()
+{
+    Command fixedString;
+    fixedString.name = "fixed";
+    fixedString.automatic = true;
+    fixedString.cmd = "true";
+    fixedString.re = QRegExp("Hello World", Qt::CaseSensitive, QRegExp::FixedString);
+
+    Command fixedStringNoCase = fixedString;
+    fixedStringNoCase.name = "fixed, case-insensitive";
+    fixedStringNoCase.re.setCaseSensitivity(Qt::CaseInsensitive);
+
+    Command regExp = fixedString;
+    regExp.name = "regexp";
+    regExp.re = QRegExp("URL: [a-z]+");
+
+    CommandMatcher matcher;
+    matcher.setCommands( QList<Command>() << fixedString << fixedStringNoCase << regExp );
+
+    QMimeData data;
+    QList<Command> commands;
+
+    // Mixed-case literal required by fixed-string pattern must be found.
+    data.setText("say Hello World!");
+    commands = matcher.match(data, data.text());
+    QCOMPARE( commands.size(), 2 );
+    QCOMPARE( commands[0].name, fixedString.name );
+    QCOMPARE( commands[1].name, fixedStringNoCase.name );
+
+    data.setText("say HELLO WORLD!");
+    commands = matcher.match(data, data.text());
+    QCOMPARE( commands.size(), 1 );
+    QCOMPARE( commands[0].name, fixedStringNoCase.name );
+
+    data.setText("URL: example");
+    commands = matcher.match(data, data.text());
+    QCOMPARE( commands.size(), 1 );
+    QCOMPARE( commands[0].name, regExp.name );
+
+    data.setText("url: example");
+    QVERIFY( matcher.match(data, data.text()).isEmpty() );
+}
+
+void Tests::actionScheduler()
+{
+    ActionScheduler scheduler;
+    scheduler.setMaxRunning(2);
+
+    QList<Action*> actions;
+    for (int i = 0; i < 4; ++i) {
+        actions.append( createSleepAction(QString("automatic %1").arg(i), true) );
+        scheduler.schedule( actions.last() );
+    }
+
+    // Automatic actions over the limit wait until others finish.
+    QCOMPARE( scheduler.runningCount(), 2 );
+    QCOMPARE( scheduler.queuedCount(), 2 );
+    QVERIFY( actions[0]->state() != QProcess::NotRunning );
+    QVERIFY( actions[1]->state() != QProcess::NotRunning );
+    QVERIFY( actions[2]->state() == QProcess::NotRunning );
+    QVERIFY( actions[3]->state() == QProcess::NotRunning );
+
+    // Actions started by user are not limited.
+    actions.append( createSleepAction("manual", false) );
+    scheduler.schedule( actions.last() );
+    QCOMPARE( scheduler.runningCount(), 2 );
+    QVERIFY( actions.last()->state() != QProcess::NotRunning );
+
+    // Queued action is replaced by newer one for same command and output.
+    QPointer<Action> outdated = actions[3];
+    actions[3] = createSleepAction("automatic 3", true);
+    scheduler.schedule( actions[3] );
+    QCOMPARE( scheduler.queuedCount(), 2 );
+    QCOMPARE( scheduler.stats().value("coalesced").toInt(), 1 );
+    QCoreApplication::sendPostedEvents(NULL, QEvent::DeferredDelete);
+    QVERIFY( outdated.isNull() );
+
+    // Action with different output is not replaced.
+    Action *otherOutput = createSleepAction("automatic 3", true, "other tab");
+    scheduler.schedule(otherOutput);
+    QCOMPARE( scheduler.queuedCount(), 3 );
+
+    // Only queued actions can be canceled.
+    QVERIFY( scheduler.cancel(otherOutput) );
+    QCOMPARE( scheduler.queuedCount(), 2 );
+    QVERIFY( !scheduler.cancel(actions[0]) );
+
+    // Queued actions are started after running ones finish.
+    QElapsedTimer t;
+    t.start();
+    while ( (scheduler.runningCount() > 0 || scheduler.queuedCount() > 0) && !t.hasExpired(10000) )
+        waitWithEvents(50);
+    QCOMPARE( scheduler.queuedCount(), 0 );
+    QCOMPARE( scheduler.runningCount(), 0 );
+
+    foreach (Action *action, actions) {
+        QVERIFY( action->waitForFinished(5000) || action->state() == QProcess::NotRunning );
+        QCOMPARE( action->exitCode(), 0 );
+    }
+
+    qDeleteAll(actions);
+}
+
+void Tests::trayMenuElidedText()
+{
+    const QString text = QString("Long item text. ").repeated(200);
+
+    ClipboardItem item;
+    item.setData( QVariant(text) );
+
+    QFont font = QApplication::font();
+    font.setPixelSize(8);
+
+    TrayMenu menu;
+    menu.setFont(font);
+    menu.setClipboardItemActions( QList<const ClipboardItem *>() << &item, false, 0 );
+
+    QCOMPARE( menu.actions().size(), 3 );
+    QAction *act = menu.actions().first();
+    const QString smallFontText = act->text();
+    QVERIFY( smallFontText.startsWith("&0. ") );
+    QCOMPARE( smallFontText.mid(4), elideText(text, -1, QFontMetrics(font)) );
+
+    // Changing font must elide cached item text again.
+    font.setPixelSize(32);
+    menu.setFont(font);
+
+    const QString largeFontText = act->text();
+    QVERIFY( largeFontText.startsWith("&0. ") );
+    QCOMPARE( largeFontText.mid(4), elideText(text, -1, QFontMetrics(font)) );
+    QVERIFY( largeFontText.size() < smallFontText.size() );
+}
+
+void Tests::selectionAfterButtonRelease()
+{
+#if defined(COPYQ_WS_X11) && defined(HAS_X11TEST) && defined(HAS_X11XINPUT2)
+    RUN(Args("config") << "check_selection" << "true", "");
+
+    Display *display = XOpenDisplay(NULL);
+    QVERIFY(display != NULL);
+
+    // Press mouse button and drag as if user is selecting text.
+    XTestFakeMotionEvent(display, -1, 10, 10, CurrentTime);
+    XTestFakeButtonEvent(display, 1, True, CurrentTime);
+    XTestFakeMotionEvent(display, -1, 50, 10, CurrentTime);
+    XSync(display, False);
+
+    const QByteArray text = "TEST_SELECTION";
+    QElapsedTimer selectionTime;
+    selectionTime.start();
+    QApplication::clipboard()->setText(text, QClipboard::Selection);
+
+    // Incomplete selection must not be stored.
+    waitWithEvents(waitMsClipboard);
+    QByteArray stdoutData;
+    QCOMPARE( run(Args("read") << "0", &stdoutData), 0 );
+    QVERIFY( stdoutData != text );
+
+    // Release button between fallback polling intervals (1 s) of the monitor.
+    waitWithEvents( qMax(0, 1200 - static_cast<int>(selectionTime.elapsed())) );
+    XTestFakeMotionEvent(display, -1, 90, 10, CurrentTime);
+    XTestFakeButtonEvent(display, 1, False, CurrentTime);
+    XSync(display, False);
+
+    // Selection is stored right after button release without waiting for next poll.
+    waitWithEvents(300);
+    QCOMPARE( run(Args("read") << "0", &stdoutData), 0 );
+    QCOMPARE( stdoutData.data(), text.data() );
+    QVERIFY2( selectionTime.elapsed() < 2000, "Selection was stored only after polling." );
+
+    XCloseDisplay(display);
+    RUN(Args("config") << "check_selection" << "false", "");
+#endif
+}
+
+void Tests::incrementalSelectionTransfer()
+{
+#ifdef COPYQ_WS_X11
+    // Data larger than maximum X request size are sent using INCR protocol.
+    const QString mime("application/x-copyq-test");
+    QByteArray bytes;
+    bytes.reserve(20 * 1024 * 1024);
+    for (int i = 0; bytes.size() < 20 * 1024 * 1024; ++i)
+        bytes.append( QByteArray::number(i) );
+
+    QMimeData *data = new QMimeData;
+    data->setData(mime, bytes);
+    QApplication::clipboard()->setMimeData(data, QClipboard::Selection);
+    QApplication::processEvents();
+
+    X11SelectionReader reader(true, mime, bytes.size());
+    reader.start();
+
+    // Process events so the selection owned by tests can be retrieved.
+    QElapsedTimer t;
+    t.start();
+    while ( !reader.wait(10) && !t.hasExpired(20000) )
+        QApplication::processEvents();
+
+    QVERIFY( reader.isFinished() );
+    QVERIFY2( reader.isValid(), reader.errorString().toLatin1() );
+    const QByteArray received = reader.data();
+    QCOMPARE( received.size(), bytes.size() );
+    QVERIFY( received == bytes );
+#endif
+}
+
+void Tests::largeDataSharing()
+{
+    // Data received from server are set to clipboard, primary selection and
+    // synchronized with the other mode; all copies must share single payload.
+    const int size = 50 * 1024 * 1024;
+    const QString mime("image/png");
+
+    QScopedPointer<QMimeData> clipboardData(new QMimeData);
+    {
+        QMimeData data;
+        data.setData( mime, QByteArray(size, 'x') );
+        QVERIFY( deserializeData(clipboardData.data(), serializeData(data)) );
+    }
+
+    const qint64 memoryBefore = residentMemory();
+
+    // See ClipboardMonitor::updateClipboard() and PrivateX11::synchronize().
+    QScopedPointer<QMimeData> selectionData( cloneData(*clipboardData) );
+    QScopedPointer<QMimeData> syncData( cloneData(*selectionData) );
+    QCOMPARE( syncData->data(mime).size(), size );
+
+    const qint64 memoryCloned = residentMemory();
+
+    // Only the message sent to server contains copy of the payload.
+    const QByteArray message = serializeData(*syncData);
+    QVERIFY( message.size() > size );
+
+    const qint64 memorySerialized = residentMemory();
+
+    if (memoryBefore != -1) {
+        QVERIFY2( memoryCloned - memoryBefore < size / 10,
+                  QString("Copies of 50 MB payload allocated %1 bytes")
+                  .arg(memoryCloned - memoryBefore).toLatin1() );
+        QVERIFY2( memorySerialized - memoryCloned < size + size / 10,
+                  QString("Serializing 50 MB payload allocated %1 bytes")
+                  .arg(memorySerialized - memoryCloned).toLatin1() );
+    }
+
+    QMimeData received;
+    QVERIFY( deserializeData(&received, message) );
+    QCOMPARE( received.data(mime), clipboardData->data(mime) );
+}
+
 bool Tests::startServer()
 {
     if (m_server != NULL)
@@ -493,20 +1028,15 @@ void Tests::setClipboard(const QByteArray &bytes, const QString &mime)
         m_monitor = new RemoteProcess();
         const QString name = clipboardMonitorServerName() + "_TEST";
         m_monitor->start( name, QStringList("monitor") << name );
+        m_monitor->waitForConnected();
     }
 
     QVERIFY( m_monitor->isConnected() );
 
-    // Create item.
-    ClipboardItem item;
-    item.setData(mime, bytes);
-
-    // Send item.
-    QByteArray msg;
-    QDataStream out(&msg, QIODevice::WriteOnly);
-    out << item;
+    QMimeData data;
+    data.setData(mime, bytes);
 
-    QVERIFY( m_monitor->writeMessage(msg) );
+    QVERIFY( m_monitor->writeMessage(serializeData(data)) );
     QApplication::processEvents();
 
     qSleep(waitMsClipboard);
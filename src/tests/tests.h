@@ -47,12 +47,25 @@ private slots:
     void itemToClipboard();
     void tabAddRemove();
     void action();
+    void actionManyItems();
     void insertRemoveItems();
     void renameTab();
     void importExportTab();
     void separator();
     void eval();
+    void evalReadItems();
+    void evalLargeOutput();
+    void batch();
     void rawData();
+    void rawDataLargeInput();
+    void stats();
+    void windowTitleCache();
+    void commandMatcher();
+    void actionScheduler();
+    void trayMenuElidedText();
+    void selectionAfterButtonRelease();
+    void incrementalSelectionTransfer();
+    void largeDataSharing();
 
 private:
     bool startServer();